@@ -210,6 +210,7 @@ enum ixgbe_tx_flags {
 #define IXGBE_MAX_RX_DESC_POLL		10
 
 #define IXGBE_MAX_VF_MC_ENTRIES		30
+#define IXGBE_MTA_BITS			(IXGBE_MAX_MTA * 32)
 #define IXGBE_MAX_VF_FUNCTIONS		64
 #define IXGBE_MAX_VFTA_ENTRIES		128
 #define MAX_EMULATION_MAC_ADDRS		16
@@ -222,28 +223,14 @@ enum ixgbe_tx_flags {
 #define VMDQ_P(p)	(p)
 #endif
 
-#define UPDATE_VF_COUNTER_32bit(reg, last_counter, counter)	\
-	{							\
-		u32 current_counter = IXGBE_READ_REG(hw, reg);	\
-		if (current_counter < last_counter)		\
-			counter += 0x100000000LL;		\
-		last_counter = current_counter;			\
-		counter &= 0xFFFFFFFF00000000LL;		\
-		counter |= current_counter;			\
-	}
+/* width masks of the free running VF statistics registers */
+#define IXGBE_VF_COUNTER_32BIT	0xFFFFFFFFULL
+#define IXGBE_VF_COUNTER_36BIT	0xFFFFFFFFFULL
 
-#define UPDATE_VF_COUNTER_36bit(reg_lsb, reg_msb, last_counter, counter) \
-	{								 \
-		u64 current_counter_lsb = IXGBE_READ_REG(hw, reg_lsb);	 \
-		u64 current_counter_msb = IXGBE_READ_REG(hw, reg_msb);	 \
-		u64 current_counter = (current_counter_msb << 32) |	 \
-			current_counter_lsb;				 \
-		if (current_counter < last_counter)			 \
-			counter += 0x1000000000LL;			 \
-		last_counter = current_counter;				 \
-		counter &= 0xFFFFFFF000000000LL;			 \
-		counter |= current_counter;				 \
-	}
+/* VF statistics worker cadence in milliseconds */
+#define IXGBE_VF_STATS_INTERVAL_MIN	100
+#define IXGBE_VF_STATS_INTERVAL_MAX	60000
+#define IXGBE_VF_STATS_INTERVAL_DEF	1000
 
 struct vf_stats {
 	u64 gprc;
@@ -253,6 +240,33 @@ struct vf_stats {
 	u64 mprc;
 };
 
+struct ixgbe_adapter;
+
+/* completion for a queued PF to VF message: 0 once the VF has acknowledged
+ * it, -ETIMEDOUT if it never did and -ECONNRESET if the VF was reset first
+ */
+typedef void (*ixgbe_vf_mbx_done_t)(struct ixgbe_adapter *adapter, u32 vf,
+				    u32 *msg, int status);
+
+struct ixgbe_vf_mbx_req {
+	u32 msg[IXGBE_VFMAILBOX_SIZE];
+	ixgbe_vf_mbx_done_t done;
+	u16 size;
+};
+
+#define IXGBE_VF_MBX_TXQ_LEN	8
+#define IXGBE_VF_MBX_ACK_TIMEOUT	(HZ / 2)
+
+/* per VF queue of PF to VF messages, the head is posted to the mailbox */
+struct ixgbe_vf_mbx_txq {
+	spinlock_t lock;
+	struct ixgbe_vf_mbx_req req[IXGBE_VF_MBX_TXQ_LEN];
+	unsigned long posted;	/* jiffies when the head was posted */
+	u8 head;
+	u8 count;
+	bool inflight;
+};
+
 struct vf_data_storage {
 	struct pci_dev *vfdev;
 	unsigned char vf_mac_addresses[ETH_ALEN];
@@ -262,10 +276,14 @@ struct vf_data_storage {
 	struct vf_stats vfstats;
 	struct vf_stats last_vfstats;
 	struct vf_stats saved_rst_vfstats;
+	struct vf_stats prev_vfstats;	/* totals at the last rate sample */
+	struct vf_stats vfrate;		/* per second rates */
+	unsigned long vfrate_jiffies;
 	bool pf_set_mac;
 	u16 pf_vlan; /* When set, guest VLAN config not allowed. */
 	u16 pf_qos;
 	u16 tx_rate;
+	u16 min_tx_rate;
 	int link_enable;
 #ifdef HAVE_NDO_SET_VF_LINK_STATE
 	int link_state;
@@ -275,9 +293,13 @@ struct vf_data_storage {
 	bool rss_query_enabled;
 #endif
 	u8 trusted;
+	u8 num_queues;	/* RSS queues offered to the VF, 0 for the whole pool */
+	u32 cfg_gen;	/* generation of the filter state, 0 if not kept */
 	int xcast_mode;
 	unsigned int vf_api;
+	u8 priv_caps;	/* IXGBE_VF_PRIV_CAP_* agreed with the VF */
 	u8 primary_abort_count;
+	struct ixgbe_vf_mbx_txq mbx_txq;
 };
 
 struct vf_macvlans {
@@ -378,6 +400,11 @@ struct ixgbe_rx_queue_stats {
 	u64 alloc_rx_page_failed;
 	u64 alloc_rx_buff_failed;
 	u64 csum_err;
+	u64 fdir_match;
+	u64 tstamp_approx;	/* see ixgbe_ptp_rx_approx() */
+	/* back-to-back hits on one perfect filter, see ixgbe_fdir_flush_hits */
+	u32 fdir_run;
+	u16 fdir_run_idx;
 };
 
 #define IXGBE_TS_HDR_LEN 8
@@ -471,8 +498,13 @@ struct ixgbe_ring {
 		struct {
 			u8 atr_sample_rate;
 			u8 atr_count;
+			u8 atr_udp_sample_rate;
+			u8 atr_udp_count;
 		};
 	};
+	/* connectionless ATR admission window, see ixgbe_atr_admit() */
+	unsigned long atr_udp_window;
+	u16 atr_udp_admitted;
 
 #ifdef HAVE_XDP_SUPPORT
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
@@ -481,7 +513,10 @@ struct ixgbe_ring {
 #endif /* HAVE_XDP_SUPPORT */
 
 	u8 dcb_tc;
-	struct ixgbe_queue_stats stats;
+	/* written by the cleaning CPU only, keep off the lines the
+	 * transmit path and the stats readers share with it
+	 */
+	struct ixgbe_queue_stats stats ____cacheline_aligned_in_smp;
 #ifdef HAVE_NDO_GET_STATS64
 	struct u64_stats_sync syncp;
 #endif
@@ -619,6 +654,19 @@ struct ixgbe_ring_container {
 
 #define IXGBE_IFNAMSIZ (IFNAMSIZ + 9)
 
+/* log2 histograms kept per q_vector while enabled through the
+ * "histograms" debugfs file. Bucket n counts values in [2^(n-1), 2^n),
+ * bucket 0 counts zeroes and the last bucket is open ended.
+ */
+enum ixgbe_hist_id {
+	IXGBE_HIST_RX_PKTS,	/* packets per Rx ring clean */
+	IXGBE_HIST_TX_DESCS,	/* descriptors per Tx ring clean */
+	IXGBE_HIST_IRQ_POLL,	/* interrupt to NAPI poll, in ns */
+	IXGBE_HIST_NUM
+};
+
+#define IXGBE_HIST_BUCKETS	32
+
 /* MAX_MSIX_Q_VECTORS of these are allocated,
  * but we only use one per queue-specific vector.
  */
@@ -642,10 +690,17 @@ struct ixgbe_q_vector {
 	struct rcu_head rcu;	/* to avoid race with update stats on free */
 	char name[IXGBE_IFNAMSIZ];
 	bool netpoll_rx;
+#ifdef HAVE_PTP_1588_CLOCK
+	u64 rx_tstamp_ns;	/* SYSTIME of this NAPI poll, 0 until read */
+#endif
 
 #ifdef HAVE_NDO_BUSY_POLL
 	atomic_t state;
 #endif  /* HAVE_NDO_BUSY_POLL */
+#ifdef HAVE_IXGBE_DEBUG_FS
+	u64 irq_ns;	/* when the interrupt fired, 0 once polled */
+	u64 hist[IXGBE_HIST_NUM][IXGBE_HIST_BUCKETS];
+#endif
 
 	/* for dynamic allocation of rings associated with this q_vector */
 	struct ixgbe_ring ring[0] ____cacheline_internodealigned_in_smp;
@@ -846,6 +901,75 @@ struct ixgbe_therm_proc_data {
 
 #define IXGBE_PRIMARY_ABORT_LIMIT	5
 
+/* Periodic subtasks. The service task keeps its timer and event driven
+ * scheduling, the others run from their own delayed work so that a slow
+ * service run (an SFP I2C probe, a firmware command) cannot hold them back.
+ */
+enum ixgbe_subtask_id {
+	IXGBE_SUBTASK_SERVICE,	/* link, SFP, overtemp, watchdog, FDIR, reset */
+	IXGBE_SUBTASK_HANG,	/* Tx hang detection */
+	IXGBE_SUBTASK_STATS,	/* hardware statistics harvest */
+#ifdef HAVE_PTP_1588_CLOCK
+	IXGBE_SUBTASK_PTP,	/* PTP overflow and timestamp hang checks */
+#endif
+	IXGBE_SUBTASK_NUM
+};
+
+#define IXGBE_SUBTASK_INTERVAL_MIN	10	/* ms */
+#define IXGBE_SUBTASK_INTERVAL_MAX	60000	/* ms */
+
+struct ixgbe_subtask {
+	struct delayed_work work;	/* unused by the service task */
+	struct ixgbe_adapter *adapter;
+	void (*fn)(struct ixgbe_adapter *adapter);
+	const char *name;
+	u32 interval;			/* milliseconds */
+	/* runtime accounting, see the "subtasks" debugfs file */
+	u64 runs;
+	u64 total_ns;
+	u64 last_ns;
+	u64 max_ns;
+};
+
+/* Statistics registers beyond those feeding the netdev counters are read
+ * in blocks. A block is read on every harvest while ethtool has read the
+ * statistics within IXGBE_STATS_SUB_TIMEOUT, and otherwise only as often
+ * as its narrowest clear-on-read counter needs to not wrap unseen.
+ */
+enum ixgbe_stats_block {
+	IXGBE_STATS_BLK_SIZE,	/* packet size buckets, RJC, TPR, BPTC */
+	IXGBE_STATS_BLK_QUEUE,	/* per queue packets, bytes and drops */
+	IXGBE_STATS_BLK_PFC,	/* per TC XON/XOFF, 82598 RNBC */
+	IXGBE_STATS_BLK_MISC,	/* OS2BMC, link XON Rx, flow director, FCoE */
+	IXGBE_STATS_BLK_NUM
+};
+
+#define IXGBE_STATS_SUB_TIMEOUT		(30 * HZ)
+/* 36 bit byte counters wrap after ~55s, 32 bit packet counters after
+ * ~288s at 10Gb/s line rate
+ */
+#define IXGBE_STATS_BYTES_MAX_AGE	20000	/* ms */
+#define IXGBE_STATS_PKTS_MAX_AGE	60000	/* ms */
+
+/* how long ixgbe_get_stats64() may reuse its sum of the ring counters */
+#define IXGBE_RING_TOTALS_MAX_AGE	100	/* ms */
+#define IXGBE_RING_TOTALS_MAX_AGE_LIMIT	1000	/* ms */
+
+#ifdef HAVE_PTP_1588_CLOCK
+/* X550 and later: SDP0-3 can be routed to two periodic outputs (target
+ * time plus FREQOUT) and two auxiliary timestamp inputs
+ */
+#define IXGBE_PTP_N_SDP			4
+#define IXGBE_PTP_N_PEROUT		2
+#define IXGBE_PTP_N_EXTTS		2
+
+struct ixgbe_ptp_perout {
+	u64 start;	/* PHC time of the first edge, in ns */
+	u64 period;	/* in ns, 0 when the channel is off */
+	u8 pin;
+};
+#endif /* HAVE_PTP_1588_CLOCK */
+
 enum ixgbe_state_t {
 	__IXGBE_TESTING,
 	__IXGBE_RESETTING,
@@ -863,6 +987,22 @@ enum ixgbe_state_t {
 	__IXGBE_STATE_T_NUM /* Must be last */
 };
 
+/* RSS key and redirection table of one x550 VMDq pool */
+#define IXGBE_POOL_RETA_ENTRIES	64
+struct ixgbe_pool_rss {
+	u32 key[10];
+	u8 indir[IXGBE_POOL_RETA_ENTRIES];
+	u32 rss_context;	/* ethtool RSS context id, 0 if unused */
+};
+
+/* ntuple rule steering a destination MAC into an RSS context's pool */
+struct ixgbe_rss_ctx_rule {
+	struct hlist_node node;
+	u8 addr[ETH_ALEN];
+	u16 sw_idx;
+	u32 rss_context;
+};
+
 /* board specific private data structure */
 struct ixgbe_adapter {
 #if defined(NETIF_F_HW_VLAN_TX) || defined(NETIF_F_HW_VLAN_CTAG_TX)
@@ -958,9 +1098,15 @@ struct ixgbe_adapter {
 #define IXGBE_FLAG2_VLAN_PROMISC		(u32)(1 << 18)
 #define IXGBE_FLAG2_RX_LEGACY			(u32)(1 << 19)
 #define IXGBE_FLAG2_AUTO_DISABLE_VF		BIT(20)
+#define IXGBE_FLAG2_VF_MC_RESTORE		BIT(21)
+#define IXGBE_FLAG2_MDD_RECHECK			BIT(22)
+#define IXGBE_FLAG2_RX_TSTAMP_APPROX		BIT(23)
 #define IXGBE_FLAG2_PHY_FW_LOAD_FAILED		BIT(24)
 #define IXGBE_FLAG2_NO_MEDIA			BIT(25)
 #define IXGBE_FLAG2_FWLOG_CAPABLE		BIT(26)
+#define IXGBE_FLAG2_RSS_REBALANCE		BIT(27)
+#define IXGBE_FLAG2_RSS_SYMMETRIC		BIT(28)
+#define IXGBE_FLAG2_RX_TSTAMP_APPROX_ON		BIT(29)
 
 	/* Tx fast path data */
 	int num_tx_queues;
@@ -1060,6 +1206,18 @@ struct ixgbe_adapter {
 
 	struct timer_list service_timer;
 	struct work_struct service_task;
+	struct ixgbe_subtask subtasks[IXGBE_SUBTASK_NUM];
+
+	/* held for writing by the stats harvest, readers only retry */
+	seqlock_t stats_lock;
+	unsigned long stats_subscribed;	/* jiffies of the last ethtool read */
+	unsigned long stats_blk_read[IXGBE_STATS_BLK_NUM];
+#ifdef HAVE_NDO_GET_STATS64
+	/* ring packet and byte counters, summed under stats_lock */
+	struct rtnl_link_stats64 ring_totals;
+	unsigned long ring_totals_stamp;	/* jiffies */
+	u32 ring_totals_max_age;		/* ms, 0 sums on every read */
+#endif
 
 	struct hlist_head fdir_filter_list;
 	unsigned long fdir_overflow; /* number of times ATR was backed off */
@@ -1067,7 +1225,15 @@ struct ixgbe_adapter {
 	int fdir_filter_count;
 	u32 fdir_pballoc;
 	u32 atr_sample_rate;
+	u32 atr_udp_sample_rate;
+/* most UDP/SCTP ATR filters a Tx ring may add per second */
+#define IXGBE_ATR_UDP_ADMIT_RATE	256
 	spinlock_t fdir_perfect_lock;
+/* largest perfect filter table, FdirPballoc=3 */
+#define IXGBE_FDIR_MAX_RULES	((1024 << IXGBE_FDIR_PBALLOC_256K) - 2)
+	atomic64_t *fdir_rule_hits;	/* indexed by filter location */
+	unsigned long *fdir_rule_map;	/* locations holding a filter */
+	atomic64_t fdir_stray_hits;	/* hits on a location without one */
 
 #if IS_ENABLED(CONFIG_FCOE)
 	struct ixgbe_fcoe fcoe;
@@ -1094,25 +1260,54 @@ struct ixgbe_adapter {
 	struct ptp_clock_info ptp_caps;
 	struct work_struct ptp_tx_work;
 	struct sk_buff *ptp_tx_skb;
+	/* skbs waiting for the Tx timestamp slot, see ixgbe_ptp_tx_request() */
+	struct sk_buff_head ptp_tx_queue;
+	/* skb handed the slot but not yet posted, see ixgbe_ptp_tx_next() */
+	struct sk_buff *ptp_tx_resend;
+	struct work_struct ptp_tx_resend_work;
+	struct hrtimer ptp_tx_timer;	/* Tx timestamp poll */
+	u32 ptp_tx_poll_ns;
 	struct hwtstamp_config tstamp_config;
 	unsigned long ptp_tx_start;
 	unsigned long last_overflow_check;
 	unsigned long last_rx_ptp_check;
 	spinlock_t tmreg_lock;
+	/* written under tmreg_lock, lets timestamp conversion read hw_cc
+	 * and hw_tc without taking it
+	 */
+	seqcount_t hw_tc_seq;
 	struct cyclecounter hw_cc;
 	struct timecounter hw_tc;
 	u32 base_incval;
 	u32 tx_hwtstamp_timeouts;
 	u32 tx_hwtstamp_skipped;
+	u32 tx_hwtstamp_deferred;
 	u32 rx_hwtstamp_cleared;
+	/* approximate Rx timestamps and their error against latched ones */
+	u64 rx_hwtstamp_approx;
+	u64 rx_hwtstamp_approx_err_sum;
+	u32 rx_hwtstamp_approx_err_cnt;
+	u32 rx_hwtstamp_approx_err_max;
+	u32 rx_hwtstamp_approx_err_avg;
+	u32 ptp_read_bracket_ns;	/* see ixgbe_ptp_gettimex() */
 	void (*ptp_setup_sdp) (struct ixgbe_adapter *);
+	struct ptp_pin_desc ptp_pins[IXGBE_PTP_N_SDP];
+	struct ixgbe_ptp_perout ptp_perout[IXGBE_PTP_N_PEROUT];
+	u8 ptp_extts_pin[IXGBE_PTP_N_EXTTS];
+	u8 ptp_extts_ena;		/* bitmap of enabled EXTTS channels */
+	u8 ptp_sdp_native;		/* SDPs switched to TimeSync by us */
 #endif /* HAVE_PTP_1588_CLOCK */
 
 	DECLARE_BITMAP(active_vfs, IXGBE_MAX_VF_FUNCTIONS);
 	unsigned int num_vfs;
 	unsigned int max_vfs;
 	struct vf_data_storage *vfinfo;
+	struct delayed_work mbx_task;
+	struct delayed_work vf_stats_task;
+	u32 vf_stats_interval;	/* milliseconds */
 	int vf_rate_link_speed;
+	u16 vf_rate_burst;	/* RTTBCNRM MMW_SIZE, 0 = MAC default */
+	u32 vf_cfg_gen;		/* last VF filter state generation handed out */
 	struct vf_macvlans vf_mvs;
 	struct vf_macvlans *mv_list;
 #ifdef CONFIG_PCI_IOV
@@ -1120,6 +1315,13 @@ struct ixgbe_adapter {
 	u32 vferr_refcount;
 #endif
 	struct ixgbe_mac_addr *mac_table;
+	/* multicast hash bits shared by the PF and VFs, see ixgbe_mta_get() */
+	spinlock_t mta_lock;
+	u16 mta_refcnt[IXGBE_MTA_BITS];
+	u32 mta_bits_used;
+	DECLARE_BITMAP(mta_dirty, IXGBE_MAX_MTA);
+	DECLARE_BITMAP(pf_mta, IXGBE_MTA_BITS);
+	DECLARE_BITMAP(pf_mta_new, IXGBE_MTA_BITS);
 	u16 tx_hang_count[IXGBE_MAX_TX_QUEUES];
 	u16 lse_mask;
 #ifdef IXGBE_SYSFS
@@ -1146,6 +1348,7 @@ struct ixgbe_adapter {
 	struct dentry *ixgbe_dbg_adapter_fw_cluster;
 	void *ixgbe_cluster_blk;
 	u16 fw_dump_cluster_id;
+	bool hist_enabled;
 #endif /*HAVE_IXGBE_DEBUG_FS*/
 	u8 default_up;
 #ifdef HAVE_TC_SETUP_CLSU32
@@ -1158,11 +1361,33 @@ struct ixgbe_adapter {
  * driver: currently it's x550 device in non-SRIOV mode
  */
 #define IXGBE_MAX_RETA_ENTRIES 512
+/* time to wait after a RETA move, or after the table is rebuilt */
+#define IXGBE_RSS_REBAL_HOLDOFF		(6 * HZ)
+/* shorter sample windows are extended, longer ones are discarded */
+#define IXGBE_RSS_REBAL_MIN_WINDOW	(HZ / 2)
+#define IXGBE_RSS_REBAL_MAX_WINDOW	(10 * HZ)
+/* ignore sample windows with a lower total Rx rate (packets/s) */
+#define IXGBE_RSS_REBAL_MIN_PPS		5000
 	u8 rss_indir_tbl[IXGBE_MAX_RETA_ENTRIES];
 
 #define IXGBE_RSS_KEY_SIZE     40  /* size of RSS Hash Key in bytes */
+#define IXGBE_RSS_SYM_KEY_WORD	0x6d5a6d5a /* symmetric Toeplitz key */
 	u32 *rss_key;
 
+	/* dynamic RETA rebalancing, see ixgbe_rss_rebalance_subtask() */
+	u64 rss_rebal_last_pkts[IXGBE_MAX_RSS_INDICES_X550];
+	unsigned long rss_rebal_last_sample;	/* jiffies */
+	unsigned long rss_rebal_holdoff;	/* no moves before, jiffies */
+	u64 rss_rebal_moves;
+	u64 rss_rebal_unsplittable;
+	u32 rss_rebal_cursor;
+
+	/* x550 per-pool RSS state, indexed by PF pool (0 uses rss_indir_tbl) */
+	struct ixgbe_pool_rss *pool_rss;
+	struct hlist_head rss_ctx_rule_list;
+	u16 rss_ctx_rule_count;
+	u8 num_rss_contexts;
+
 #ifdef HAVE_TX_MQ
 #ifndef HAVE_NETDEV_SELECT_QUEUE
 	unsigned int indices;
@@ -1224,11 +1449,25 @@ static inline u8 ixgbe_max_rss_indices(struct ixgbe_adapter *adapter)
 	}
 }
 
+/* x550 hashes each pool with its own key and RETA under SR-IOV, or once an
+ * ethtool RSS context has claimed a spare PF pool
+ */
+static inline bool ixgbe_pool_rss_enabled(struct ixgbe_adapter *adapter)
+{
+	if (adapter->hw.mac.type < ixgbe_mac_X550)
+		return false;
+
+	return (adapter->flags & IXGBE_FLAG_SRIOV_ENABLED) ||
+	       ((adapter->flags & IXGBE_FLAG_VMDQ_ENABLED) &&
+		adapter->num_rss_contexts);
+}
+
 struct ixgbe_fdir_filter {
 	struct  hlist_node fdir_node;
 	union ixgbe_atr_input filter;
 	u16 sw_idx;
 	u64 action;
+	unsigned long cookie;	/* tc flower rule, 0 for ethtool and u32 */
 };
 
 struct ixgbe_cb {
@@ -1294,6 +1533,10 @@ void ixgbe_configure_rx_ring(struct ixgbe_adapter *,
 void ixgbe_configure_tx_ring(struct ixgbe_adapter *,
 				    struct ixgbe_ring *);
 void ixgbe_update_stats(struct ixgbe_adapter *adapter);
+void ixgbe_stats_subscribe(struct ixgbe_adapter *adapter);
+void ixgbe_vf_stats_task(struct work_struct *work);
+int ixgbe_set_subtask_interval(struct ixgbe_adapter *adapter,
+			       const char *name, u32 interval);
 int ixgbe_init_interrupt_scheme(struct ixgbe_adapter *adapter);
 void ixgbe_reset_interrupt_capability(struct ixgbe_adapter *adapter);
 void ixgbe_set_interrupt_capability(struct ixgbe_adapter *adapter);
@@ -1312,11 +1555,14 @@ void ixgbe_clear_rscctl(struct ixgbe_adapter *adapter,
 #if defined(HAVE_UDP_ENC_RX_OFFLOAD) || defined(HAVE_VXLAN_RX_OFFLOAD)
 void ixgbe_clear_udp_tunnel_port(struct ixgbe_adapter *, u32);
 #endif
+bool ixgbe_fdir_loc_is_flower(struct ixgbe_adapter *adapter, u16 sw_idx);
 int ixgbe_update_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 				    struct ixgbe_fdir_filter *input,
 				    u16 sw_idx);
 void ixgbe_set_rx_mode(struct net_device *netdev);
 int ixgbe_write_mc_addr_list(struct net_device *netdev);
+void ixgbe_mta_update(struct ixgbe_adapter *adapter, const u16 *old,
+		      u16 old_count, const u16 *new, u16 new_count);
 int ixgbe_setup_tc(struct net_device *dev, u8 tc);
 void ixgbe_tx_ctxtdesc(struct ixgbe_ring *, u32, u32, u32, u32);
 void ixgbe_do_reset(struct net_device *netdev);
@@ -1370,6 +1616,42 @@ void ixgbe_dbg_adapter_init(struct ixgbe_adapter *adapter);
 void ixgbe_dbg_adapter_exit(struct ixgbe_adapter *adapter);
 void ixgbe_dbg_init(void);
 void ixgbe_dbg_exit(void);
+
+DECLARE_STATIC_KEY_FALSE(ixgbe_hist_key);
+
+static inline void ixgbe_hist_add(struct ixgbe_q_vector *q_vector,
+				  enum ixgbe_hist_id id, u64 val)
+{
+	if (!static_branch_unlikely(&ixgbe_hist_key) ||
+	    !q_vector->adapter->hist_enabled)
+		return;
+
+	q_vector->hist[id][min_t(unsigned int, fls64(val),
+				 IXGBE_HIST_BUCKETS - 1)]++;
+}
+
+/* called from the interrupt handler, ixgbe_hist_poll() takes it up */
+static inline void ixgbe_hist_irq(struct ixgbe_q_vector *q_vector)
+{
+	if (static_branch_unlikely(&ixgbe_hist_key) &&
+	    q_vector->adapter->hist_enabled)
+		q_vector->irq_ns = ktime_get_ns();
+}
+
+static inline void ixgbe_hist_poll(struct ixgbe_q_vector *q_vector)
+{
+	if (!static_branch_unlikely(&ixgbe_hist_key) || !q_vector->irq_ns)
+		return;
+
+	ixgbe_hist_add(q_vector, IXGBE_HIST_IRQ_POLL,
+		       ktime_get_ns() - q_vector->irq_ns);
+	q_vector->irq_ns = 0;
+}
+#else
+static inline void ixgbe_hist_add(struct ixgbe_q_vector *q_vector,
+				  enum ixgbe_hist_id id, u64 val) {}
+static inline void ixgbe_hist_irq(struct ixgbe_q_vector *q_vector) {}
+static inline void ixgbe_hist_poll(struct ixgbe_q_vector *q_vector) {}
 #endif /* HAVE_IXGBE_DEBUG_FS */
 
 static inline struct netdev_queue *txring_txq(const struct ixgbe_ring *ring)
@@ -1404,16 +1686,25 @@ int ixgbe_find_vlvf_entry(struct ixgbe_hw *hw, u32 vlan);
 #ifdef HAVE_PTP_1588_CLOCK
 #ifdef IXGBE_SYSFS
 #endif /* IXGBE_SYSFS */
+enum ixgbe_ptp_tx_req {
+	IXGBE_PTP_TX_STAMP,	/* stamp this skb */
+	IXGBE_PTP_TX_DEFER,	/* skb queued, sent again when the slot frees */
+	IXGBE_PTP_TX_SKIP,	/* send without a timestamp */
+};
 void ixgbe_ptp_init(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_stop(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_suspend(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_overflow_check(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_rx_hang(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_tx_hang(struct ixgbe_adapter *adapter);
+enum ixgbe_ptp_tx_req ixgbe_ptp_tx_request(struct ixgbe_adapter *adapter,
+					   struct sk_buff *skb);
+void ixgbe_ptp_tx_start(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_rx_pktstamp(struct ixgbe_q_vector *q_vector,
 				  struct sk_buff *skb);
 void ixgbe_ptp_rx_rgtstamp(struct ixgbe_q_vector *q_vector,
 				  struct sk_buff *skb);
+void ixgbe_ptp_rx_approx(struct ixgbe_ring *rx_ring, struct sk_buff *skb);
 static inline void ixgbe_ptp_rx_hwtstamp(struct ixgbe_ring *rx_ring,
 					 union ixgbe_adv_rx_desc *rx_desc,
 					 struct sk_buff *skb)
@@ -1423,8 +1714,12 @@ static inline void ixgbe_ptp_rx_hwtstamp(struct ixgbe_ring *rx_ring,
 		return;
 	}
 
-	if (unlikely(!ixgbe_test_staterr(rx_desc, IXGBE_RXDADV_STAT_TS)))
+	if (unlikely(!ixgbe_test_staterr(rx_desc, IXGBE_RXDADV_STAT_TS))) {
+		if (rx_ring->q_vector->adapter->flags2 &
+		    IXGBE_FLAG2_RX_TSTAMP_APPROX_ON)
+			ixgbe_ptp_rx_approx(rx_ring, skb);
 		return;
+	}
 
 	ixgbe_ptp_rx_rgtstamp(rx_ring->q_vector, skb);
 
@@ -1445,7 +1740,11 @@ void ixgbe_sriov_reinit(struct ixgbe_adapter *adapter);
 #endif
 u32 ixgbe_rss_indir_tbl_entries(struct ixgbe_adapter *adapter);
 void ixgbe_store_key(struct ixgbe_adapter *adapter);
+void ixgbe_fill_rss_key(struct ixgbe_adapter *adapter, u32 *rss_key);
 void ixgbe_store_reta(struct ixgbe_adapter *adapter);
+void ixgbe_setup_pool_rss(struct ixgbe_adapter *adapter, u16 p);
+int ixgbe_rss_ctx_to_pool(struct ixgbe_adapter *adapter, u32 rss_context);
+void ixgbe_rss_ctx_prune(struct ixgbe_adapter *adapter);
 
 void ixgbe_set_rx_drop_en(struct ixgbe_adapter *adapter);
 
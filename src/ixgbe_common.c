@@ -19,7 +19,6 @@ STATIC void ixgbe_raise_eeprom_clk(struct ixgbe_hw *hw, u32 *eec);
 STATIC void ixgbe_lower_eeprom_clk(struct ixgbe_hw *hw, u32 *eec);
 STATIC void ixgbe_release_eeprom(struct ixgbe_hw *hw);
 
-STATIC s32 ixgbe_mta_vector(struct ixgbe_hw *hw, u8 *mc_addr);
 STATIC s32 ixgbe_get_san_mac_addr_offset(struct ixgbe_hw *hw,
 					 u16 *san_mac_offset);
 STATIC s32 ixgbe_read_eeprom_buffer_bit_bang(struct ixgbe_hw *hw, u16 offset,
@@ -2388,7 +2387,7 @@ s32 ixgbe_update_uc_addr_list_generic(struct ixgbe_hw *hw, u8 *addr_list,
  * by the MO field of the MCSTCTRL. The MO field is set during initialization
  * to mc_filter_type.
  **/
-STATIC s32 ixgbe_mta_vector(struct ixgbe_hw *hw, u8 *mc_addr)
+s32 ixgbe_mta_vector(struct ixgbe_hw *hw, u8 *mc_addr)
 {
 	u32 vector = 0;
 
@@ -704,6 +704,7 @@ static int ixgbe_dcbnl_ieee_getpfc(struct net_device *dev,
 	pfc->mbc = my_pfc->mbc;
 	pfc->delay = my_pfc->delay;
 
+	ixgbe_stats_subscribe(adapter);
 	for (i = 0; i < IXGBE_DCB_MAX_TRAFFIC_CLASS; i++) {
 		pfc->requests[i] = adapter->stats.pxoffrxc[i];
 		pfc->indications[i] = adapter->stats.pxofftxc[i];
@@ -2,6 +2,7 @@
 /* Copyright (C) 1999 - 2025 Intel Corporation */
 
 #include "ixgbe.h"
+#include "ixgbe_sriov.h"
 
 #ifdef HAVE_IXGBE_DEBUG_FS
 #include <linux/debugfs.h>
@@ -1179,6 +1180,548 @@ static const struct file_operations ixgbe_dbg_resolution_fops = {
 	.write = ixgbe_debugfs_resolution_write,
 };
 
+/* bytes reserved per line of the fdir_stats file */
+#define IXGBE_DBG_FDIR_LINE_LEN	48
+
+/**
+ * ixgbe_dbg_fdir_stats_read - read Flow Director hit counters
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ *
+ * Lists the hits of every n-tuple rule by location, followed by the
+ * number of Flow Director matches received on each Rx queue.
+ **/
+static ssize_t ixgbe_dbg_fdir_stats_read(struct file *filp,
+					 char __user *buffer,
+					 size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	struct ixgbe_fdir_filter *rule;
+	struct hlist_node *node2;
+	size_t size, len = 0;
+	ssize_t ret;
+	char *buf;
+	int i;
+
+	size = (adapter->fdir_filter_count + adapter->num_rx_queues + 3) *
+	       IXGBE_DBG_FDIR_LINE_LEN;
+	buf = vzalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len, "%-8s %s\n", "rule", "hits");
+	spin_lock(&adapter->fdir_perfect_lock);
+	hlist_for_each_entry_safe(rule, node2,
+				  &adapter->fdir_filter_list, fdir_node) {
+		u64 hits = 0;
+
+		if (adapter->fdir_rule_hits &&
+		    rule->sw_idx < IXGBE_FDIR_MAX_RULES)
+			hits = atomic64_read(&adapter->fdir_rule_hits[rule->sw_idx]);
+		len += scnprintf(buf + len, size - len, "%-8u %llu\n",
+				 rule->sw_idx, hits);
+	}
+	spin_unlock(&adapter->fdir_perfect_lock);
+	len += scnprintf(buf + len, size - len, "%-8s %llu\n", "stray",
+			 (u64)atomic64_read(&adapter->fdir_stray_hits));
+
+	len += scnprintf(buf + len, size - len, "%-8s %s\n", "rx_queue",
+			 "matches");
+	for (i = 0; i < adapter->num_rx_queues; i++) {
+		struct ixgbe_ring *ring = adapter->rx_ring[i];
+
+		if (!ring)
+			continue;
+		len += scnprintf(buf + len, size - len, "%-8d %llu\n", i,
+				 ring->rx_stats.fdir_match);
+	}
+
+	ret = simple_read_from_buffer(buffer, count, ppos, buf, len);
+	vfree(buf);
+
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_fdir_stats_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_fdir_stats_read,
+};
+
+/* bytes reserved per line of the vf_stats file */
+#define IXGBE_DBG_VF_STATS_LINE_LEN	256
+
+/**
+ * ixgbe_dbg_vf_stats_read - read the statistics of all VFs
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ *
+ * Dumps one line per VF with its 64 bit counters, including those saved
+ * across resets, followed by the per second rates from the last sample.
+ **/
+static ssize_t ixgbe_dbg_vf_stats_read(struct file *filp,
+				       char __user *buffer,
+				       size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	unsigned int num_vfs = adapter->num_vfs;
+	size_t size, len = 0;
+	unsigned int vf;
+	ssize_t ret;
+	char *buf;
+
+	size = (num_vfs + 1) * IXGBE_DBG_VF_STATS_LINE_LEN;
+	buf = vzalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len,
+			 "vf rx_packets rx_bytes tx_packets tx_bytes multicast rx_pps rx_Bps tx_pps tx_Bps mc_pps\n");
+	for (vf = 0; vf < num_vfs && adapter->vfinfo; vf++) {
+		struct vf_data_storage *vfinfo = &adapter->vfinfo[vf];
+		struct vf_stats *stats = &vfinfo->vfstats;
+		struct vf_stats *saved = &vfinfo->saved_rst_vfstats;
+		struct vf_stats *rate = &vfinfo->vfrate;
+
+		len += scnprintf(buf + len, size - len,
+				 "%u %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+				 vf, stats->gprc + saved->gprc,
+				 stats->gorc + saved->gorc,
+				 stats->gptc + saved->gptc,
+				 stats->gotc + saved->gotc,
+				 stats->mprc + saved->mprc,
+				 rate->gprc, rate->gorc, rate->gptc,
+				 rate->gotc, rate->mprc);
+	}
+
+	ret = simple_read_from_buffer(buffer, count, ppos, buf, len);
+	vfree(buf);
+
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_vf_stats_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_vf_stats_read,
+};
+
+/**
+ * ixgbe_dbg_vf_queues_read - read the RSS queue count of all VFs
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ **/
+static ssize_t ixgbe_dbg_vf_queues_read(struct file *filp,
+					char __user *buffer,
+					size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	size_t size, len = 0;
+	unsigned int vf;
+	ssize_t ret;
+	char *buf;
+
+	size = (adapter->num_vfs + 1) * 32;
+	buf = vzalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len, "vf queues\n");
+	for (vf = 0; vf < adapter->num_vfs && adapter->vfinfo; vf++)
+		len += scnprintf(buf + len, size - len, "%u %u\n", vf,
+				 ixgbe_vf_queue_count(adapter, vf));
+
+	ret = simple_read_from_buffer(buffer, count, ppos, buf, len);
+	vfree(buf);
+
+	return ret;
+}
+
+/**
+ * ixgbe_dbg_vf_queues_write - limit the RSS queues used by a VF
+ * @filp: the opened file
+ * @buffer: where to find the user's data
+ * @count: the length of the user's data
+ * @ppos: file position offset
+ *
+ * Takes "<vf> <queues>", a queue count of 0 restores the full pool.
+ **/
+static ssize_t ixgbe_dbg_vf_queues_write(struct file *filp,
+					 const char __user *buffer,
+					 size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	u8 num_queues;
+	ssize_t ret;
+	char **argv;
+	int argc;
+	int vf;
+
+	/* don't allow partial writes */
+	if (*ppos != 0)
+		return 0;
+
+	ret = ixgbe_debugfs_parse_cmd_line(buffer, count, &argv, &argc);
+	if (ret)
+		return ret;
+
+	if (argc != 2 || kstrtoint(argv[0], 0, &vf) ||
+	    kstrtou8(argv[1], 0, &num_queues)) {
+		e_dev_info("vf_queues: expected \"<vf> <queues>\"\n");
+		ret = -EINVAL;
+		goto vf_queues_write_error;
+	}
+
+	rtnl_lock();
+	ret = ixgbe_set_vf_queues(adapter, vf, num_queues);
+	rtnl_unlock();
+	if (!ret)
+		ret = (ssize_t)count;
+
+vf_queues_write_error:
+	argv_free(argv);
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_vf_queues_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_vf_queues_read,
+	.write = ixgbe_dbg_vf_queues_write,
+};
+
+/**
+ * ixgbe_dbg_subtasks_read - read the cadence and runtime of periodic subtasks
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ **/
+static ssize_t ixgbe_dbg_subtasks_read(struct file *filp,
+				       char __user *buffer,
+				       size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	size_t size, len = 0;
+	ssize_t ret;
+	char *buf;
+	int i;
+
+	size = (IXGBE_SUBTASK_NUM + 1) * 96;
+	buf = vzalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len,
+			 "subtask interval_ms runs last_us avg_us max_us\n");
+	for (i = 0; i < IXGBE_SUBTASK_NUM; i++) {
+		struct ixgbe_subtask *st = &adapter->subtasks[i];
+		u64 runs = st->runs;
+
+		len += scnprintf(buf + len, size - len,
+				 "%s %u %llu %llu %llu %llu\n",
+				 st->name, st->interval, runs,
+				 div_u64(st->last_ns, NSEC_PER_USEC),
+				 runs ? div64_u64(st->total_ns,
+						  runs * NSEC_PER_USEC) : 0,
+				 div_u64(st->max_ns, NSEC_PER_USEC));
+	}
+
+	ret = simple_read_from_buffer(buffer, count, ppos, buf, len);
+	vfree(buf);
+
+	return ret;
+}
+
+/**
+ * ixgbe_dbg_subtasks_write - change the interval of a periodic subtask
+ * @filp: the opened file
+ * @buffer: where to find the user's data
+ * @count: the length of the user's data
+ * @ppos: file position offset
+ *
+ * Takes "<subtask> <interval_ms>".
+ **/
+static ssize_t ixgbe_dbg_subtasks_write(struct file *filp,
+					const char __user *buffer,
+					size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	u32 interval;
+	ssize_t ret;
+	char **argv;
+	int argc;
+
+	/* don't allow partial writes */
+	if (*ppos != 0)
+		return 0;
+
+	ret = ixgbe_debugfs_parse_cmd_line(buffer, count, &argv, &argc);
+	if (ret)
+		return ret;
+
+	if (argc != 2 || kstrtou32(argv[1], 0, &interval)) {
+		e_dev_info("subtasks: expected \"<subtask> <interval_ms>\"\n");
+		ret = -EINVAL;
+		goto subtasks_write_error;
+	}
+
+	ret = ixgbe_set_subtask_interval(adapter, argv[0], interval);
+	if (!ret)
+		ret = (ssize_t)count;
+
+subtasks_write_error:
+	argv_free(argv);
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_subtasks_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_subtasks_read,
+	.write = ixgbe_dbg_subtasks_write,
+};
+
+#ifdef HAVE_NDO_GET_STATS64
+/**
+ * ixgbe_dbg_ring_totals_read - read how long the ring totals are reused
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ **/
+static ssize_t ixgbe_dbg_ring_totals_read(struct file *filp,
+					  char __user *buffer,
+					  size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	char buf[32];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf), "max_age_ms %u\n",
+			READ_ONCE(adapter->ring_totals_max_age));
+
+	return simple_read_from_buffer(buffer, count, ppos, buf, len);
+}
+
+/**
+ * ixgbe_dbg_ring_totals_write - set how long the ring totals are reused
+ * @filp: the opened file
+ * @buffer: where to find the user's data
+ * @count: the length of the user's data
+ * @ppos: file position offset
+ *
+ * Takes a number of milliseconds, 0 sums the rings on every read.
+ **/
+static ssize_t ixgbe_dbg_ring_totals_write(struct file *filp,
+					   const char __user *buffer,
+					   size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	u32 max_age;
+	ssize_t ret;
+	char **argv;
+	int argc;
+
+	/* don't allow partial writes */
+	if (*ppos != 0)
+		return 0;
+
+	ret = ixgbe_debugfs_parse_cmd_line(buffer, count, &argv, &argc);
+	if (ret)
+		return ret;
+
+	if (argc != 1 || kstrtou32(argv[0], 0, &max_age)) {
+		e_dev_info("ring_totals: expected \"<max_age_ms>\"\n");
+		ret = -EINVAL;
+		goto ring_totals_write_error;
+	}
+
+	if (max_age > IXGBE_RING_TOTALS_MAX_AGE_LIMIT) {
+		ret = -ERANGE;
+		goto ring_totals_write_error;
+	}
+
+	WRITE_ONCE(adapter->ring_totals_max_age, max_age);
+	ret = (ssize_t)count;
+
+ring_totals_write_error:
+	argv_free(argv);
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_ring_totals_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_ring_totals_read,
+	.write = ixgbe_dbg_ring_totals_write,
+};
+
+#endif /* HAVE_NDO_GET_STATS64 */
+DEFINE_STATIC_KEY_FALSE(ixgbe_hist_key);
+
+static const char * const ixgbe_hist_names[IXGBE_HIST_NUM] = {
+	[IXGBE_HIST_RX_PKTS] = "rx_pkts",
+	[IXGBE_HIST_TX_DESCS] = "tx_descs",
+	[IXGBE_HIST_IRQ_POLL] = "irq_poll_ns",
+};
+
+/**
+ * ixgbe_dbg_hist_enable - start or stop collecting the histograms
+ * @adapter: board private structure
+ * @enable: whether the q_vectors of this adapter keep histograms
+ *
+ * The static key stays enabled while any adapter collects them.
+ **/
+static void ixgbe_dbg_hist_enable(struct ixgbe_adapter *adapter, bool enable)
+{
+	if (adapter->hist_enabled == enable)
+		return;
+
+	WRITE_ONCE(adapter->hist_enabled, enable);
+	if (enable)
+		static_branch_inc(&ixgbe_hist_key);
+	else
+		static_branch_dec(&ixgbe_hist_key);
+}
+
+/**
+ * ixgbe_dbg_hist_read - dump the per q_vector histograms
+ * @filp: the opened file
+ * @buffer: where to write the data for the user to read
+ * @count: the size of the user's buffer
+ * @ppos: file position offset
+ *
+ * One line per q_vector and histogram, listing the non-empty buckets as
+ * "<low>-<high>:<count>".
+ **/
+static ssize_t ixgbe_dbg_hist_read(struct file *filp, char __user *buffer,
+				   size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	size_t size, len = 0;
+	ssize_t ret;
+	char *buf;
+	int v, h, b;
+
+	size = (adapter->num_q_vectors * IXGBE_HIST_NUM + 1) *
+	       (IXGBE_HIST_BUCKETS + 1) * 48;
+	buf = vzalloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len, "enabled %u\n",
+			 adapter->hist_enabled);
+
+	rcu_read_lock();
+	for (v = 0; v < adapter->num_q_vectors; v++) {
+		struct ixgbe_q_vector *q_vector =
+			READ_ONCE(adapter->q_vector[v]);
+
+		if (!q_vector)
+			continue;
+
+		for (h = 0; h < IXGBE_HIST_NUM; h++) {
+			len += scnprintf(buf + len, size - len, "%u %s",
+					 q_vector->v_idx, ixgbe_hist_names[h]);
+			for (b = 0; b < IXGBE_HIST_BUCKETS; b++) {
+				u64 cnt = READ_ONCE(q_vector->hist[h][b]);
+
+				if (!cnt)
+					continue;
+				if (!b)
+					len += scnprintf(buf + len, size - len,
+							 " 0:%llu", cnt);
+				else if (b == IXGBE_HIST_BUCKETS - 1)
+					len += scnprintf(buf + len, size - len,
+							 " %llu+:%llu",
+							 1ULL << (b - 1), cnt);
+				else
+					len += scnprintf(buf + len, size - len,
+							 " %llu-%llu:%llu",
+							 1ULL << (b - 1),
+							 (1ULL << b) - 1, cnt);
+			}
+			len += scnprintf(buf + len, size - len, "\n");
+		}
+	}
+	rcu_read_unlock();
+
+	ret = simple_read_from_buffer(buffer, count, ppos, buf, len);
+	vfree(buf);
+
+	return ret;
+}
+
+/**
+ * ixgbe_dbg_hist_write - control the per q_vector histograms
+ * @filp: the opened file
+ * @buffer: where to find the user's data
+ * @count: the length of the user's data
+ * @ppos: file position offset
+ *
+ * Takes "on", "off" or "clear".
+ **/
+static ssize_t ixgbe_dbg_hist_write(struct file *filp,
+				    const char __user *buffer,
+				    size_t count, loff_t *ppos)
+{
+	struct ixgbe_adapter *adapter = filp->private_data;
+	ssize_t ret;
+	char **argv;
+	int argc, v;
+
+	/* don't allow partial writes */
+	if (*ppos != 0)
+		return 0;
+
+	ret = ixgbe_debugfs_parse_cmd_line(buffer, count, &argv, &argc);
+	if (ret)
+		return ret;
+
+	if (argc != 1) {
+		ret = -EINVAL;
+		goto hist_write_error;
+	}
+
+	ret = (ssize_t)count;
+	rtnl_lock();
+	if (!strcmp(argv[0], "on")) {
+		ixgbe_dbg_hist_enable(adapter, true);
+	} else if (!strcmp(argv[0], "off")) {
+		ixgbe_dbg_hist_enable(adapter, false);
+	} else if (!strcmp(argv[0], "clear")) {
+		for (v = 0; v < adapter->num_q_vectors; v++) {
+			struct ixgbe_q_vector *q_vector = adapter->q_vector[v];
+
+			if (q_vector)
+				memset(q_vector->hist, 0,
+				       sizeof(q_vector->hist));
+		}
+	} else {
+		e_dev_info("histograms: expected \"on\", \"off\" or \"clear\"\n");
+		ret = -EINVAL;
+	}
+	rtnl_unlock();
+
+hist_write_error:
+	argv_free(argv);
+	return ret;
+}
+
+static const struct file_operations ixgbe_dbg_hist_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.read  = ixgbe_dbg_hist_read,
+	.write = ixgbe_dbg_hist_write,
+};
+
 /**
  * ixgbe_dbg_adapter_init - setup the debugfs directory for the adapter
  * @adapter: the adapter that is starting up
@@ -1273,6 +1816,56 @@ void ixgbe_dbg_adapter_init(struct ixgbe_adapter *adapter)
 		goto create_failed;
 	}
 
+	if (!debugfs_create_file("fdir_stats", 0400,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_fdir_stats_fops)) {
+		e_dev_err("debugfs fdir_stats for %s failed\n", name);
+		goto create_failed;
+	}
+
+	if (!debugfs_create_file("vf_stats", 0400,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_vf_stats_fops)) {
+		e_dev_err("debugfs vf_stats for %s failed\n", name);
+		goto create_failed;
+	}
+
+	if (!debugfs_create_file("vf_queues", 0600,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_vf_queues_fops)) {
+		e_dev_err("debugfs vf_queues for %s failed\n", name);
+		goto create_failed;
+	}
+
+	if (!debugfs_create_file("subtasks", 0600,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_subtasks_fops)) {
+		e_dev_err("debugfs subtasks for %s failed\n", name);
+		goto create_failed;
+	}
+
+	if (!debugfs_create_file("histograms", 0600,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_hist_fops)) {
+		e_dev_err("debugfs histograms for %s failed\n", name);
+		goto create_failed;
+	}
+
+#ifdef HAVE_NDO_GET_STATS64
+	if (!debugfs_create_file("ring_totals", 0600,
+				 adapter->ixgbe_dbg_adapter_pf,
+				 adapter,
+				 &ixgbe_dbg_ring_totals_fops)) {
+		e_dev_err("debugfs ring_totals for %s failed\n", name);
+		goto create_failed;
+	}
+#endif
+
 	return;
 
 create_failed:
@@ -1289,6 +1882,7 @@ void ixgbe_dbg_adapter_exit(struct ixgbe_adapter *adapter)
 	if (adapter->ixgbe_dbg_adapter_pf)
 		debugfs_remove_recursive(adapter->ixgbe_dbg_adapter_pf);
 	adapter->ixgbe_dbg_adapter_pf = NULL;
+	ixgbe_dbg_hist_enable(adapter, false);
 
 	vfree(adapter->ixgbe_cluster_blk);
 	adapter->ixgbe_cluster_blk = NULL;
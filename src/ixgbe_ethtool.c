@@ -109,6 +109,8 @@ static struct ixgbe_stats ixgbe_gstrings_stats[] = {
 	IXGBE_STAT("rx_no_dma_resources", hw_rx_no_dma_resources),
 	IXGBE_STAT("hw_rsc_aggregated", rsc_total_count),
 	IXGBE_STAT("hw_rsc_flushed", rsc_total_flush),
+	IXGBE_STAT("rss_rebalance_moves", rss_rebal_moves),
+	IXGBE_STAT("rss_rebalance_unsplittable", rss_rebal_unsplittable),
 #ifdef HAVE_TX_MQ
 	IXGBE_STAT("fdir_match", stats.fdirmatch),
 	IXGBE_STAT("fdir_miss", stats.fdirmiss),
@@ -132,7 +134,12 @@ static struct ixgbe_stats ixgbe_gstrings_stats[] = {
 #ifdef HAVE_PTP_1588_CLOCK
 	IXGBE_STAT("tx_hwtstamp_timeouts", tx_hwtstamp_timeouts),
 	IXGBE_STAT("tx_hwtstamp_skipped", tx_hwtstamp_skipped),
+	IXGBE_STAT("tx_hwtstamp_deferred", tx_hwtstamp_deferred),
 	IXGBE_STAT("rx_hwtstamp_cleared", rx_hwtstamp_cleared),
+	IXGBE_STAT("rx_hwtstamp_approx", rx_hwtstamp_approx),
+	IXGBE_STAT("rx_hwtstamp_approx_err_max_ns", rx_hwtstamp_approx_err_max),
+	IXGBE_STAT("rx_hwtstamp_approx_err_avg_ns", rx_hwtstamp_approx_err_avg),
+	IXGBE_STAT("ptp_read_bracket_ns", ptp_read_bracket_ns),
 #endif /* HAVE_PTP_1588_CLOCK */
 };
 
@@ -195,6 +202,14 @@ static const char ixgbe_priv_flags_strings[][ETH_GSTRING_LEN] = {
 #endif
 #define IXGBE_PRIV_FLAGS_AUTO_DISABLE_VF	BIT(2)
 	"mdd-disable-vf",
+#define IXGBE_PRIV_FLAGS_RSS_REBALANCE	BIT(3)
+	"rss-rebalance",
+#define IXGBE_PRIV_FLAGS_RSS_SYMMETRIC	BIT(4)
+	"rss-symmetric",
+#ifdef HAVE_PTP_1588_CLOCK
+#define IXGBE_PRIV_FLAGS_RX_TSTAMP_APPROX	BIT(5)
+	"rx-tstamp-approx",
+#endif
 };
 
 #define IXGBE_PRIV_FLAGS_STR_LEN ARRAY_SIZE(ixgbe_priv_flags_strings)
@@ -1921,23 +1936,32 @@ static void ixgbe_get_ethtool_stats(struct net_device *netdev,
 	int stat_count, k;
 	struct ixgbe_ring *ring;
 	int i, data_index = 0;
+	unsigned int seq;
 	char *p;
 
-	ixgbe_update_stats(adapter);
+	/* only read the snapshot left by the stats subtask */
+	ixgbe_stats_subscribe(adapter);
 #ifdef HAVE_NDO_GET_STATS64
 	net_stats = dev_get_stats(netdev, &temp);
 #endif
 
-	for (i = 0; i < IXGBE_NETDEV_STATS_LEN; i++) {
-		p = (char *)net_stats + ixgbe_gstrings_net_stats[i].stat_offset;
-		data[data_index++] = (ixgbe_gstrings_net_stats[i].sizeof_stat ==
-			sizeof(u64)) ? *(u64 *)p : *(u32 *)p;
-	}
-	for (i = 0; i < IXGBE_GLOBAL_STATS_LEN; i++) {
-		p = (char *)adapter + ixgbe_gstrings_stats[i].stat_offset;
-		data[data_index++] = (ixgbe_gstrings_stats[i].sizeof_stat ==
-			   sizeof(u64)) ? *(u64 *)p : *(u32 *)p;
-	}
+	do {
+		seq = read_seqbegin(&adapter->stats_lock);
+		data_index = 0;
+		for (i = 0; i < IXGBE_NETDEV_STATS_LEN; i++) {
+			p = (char *)net_stats +
+			    ixgbe_gstrings_net_stats[i].stat_offset;
+			data[data_index++] =
+				(ixgbe_gstrings_net_stats[i].sizeof_stat ==
+				 sizeof(u64)) ? *(u64 *)p : *(u32 *)p;
+		}
+		for (i = 0; i < IXGBE_GLOBAL_STATS_LEN; i++) {
+			p = (char *)adapter + ixgbe_gstrings_stats[i].stat_offset;
+			data[data_index++] =
+				(ixgbe_gstrings_stats[i].sizeof_stat ==
+				 sizeof(u64)) ? *(u64 *)p : *(u32 *)p;
+		}
+	} while (read_seqretry(&adapter->stats_lock, seq));
 	for (i = 0; i < IXGBE_NUM_TX_QUEUES; i++) {
 		ring = adapter->tx_ring[i];
 		if (!ring) {
@@ -1998,14 +2022,19 @@ static void ixgbe_get_ethtool_stats(struct net_device *netdev,
 		data_index += 3;
 #endif
 	}
-	for (i = 0; i < IXGBE_MAX_PACKET_BUFFERS; i++) {
-		data[data_index++] = adapter->stats.pxontxc[i];
-		data[data_index++] = adapter->stats.pxofftxc[i];
-	}
-	for (i = 0; i < IXGBE_MAX_PACKET_BUFFERS; i++) {
-		data[data_index++] = adapter->stats.pxonrxc[i];
-		data[data_index++] = adapter->stats.pxoffrxc[i];
-	}
+	k = data_index;
+	do {
+		seq = read_seqbegin(&adapter->stats_lock);
+		data_index = k;
+		for (i = 0; i < IXGBE_MAX_PACKET_BUFFERS; i++) {
+			data[data_index++] = adapter->stats.pxontxc[i];
+			data[data_index++] = adapter->stats.pxofftxc[i];
+		}
+		for (i = 0; i < IXGBE_MAX_PACKET_BUFFERS; i++) {
+			data[data_index++] = adapter->stats.pxonrxc[i];
+			data[data_index++] = adapter->stats.pxoffrxc[i];
+		}
+	} while (read_seqretry(&adapter->stats_lock, seq));
 	stat_count = sizeof(struct vf_stats) / sizeof(u64);
 	for (i = 0; i < adapter->num_vfs; i++) {
 		queue_stat = (u64 *)&adapter->vfinfo[i].vfstats;
@@ -3584,6 +3613,145 @@ static int ixgbe_set_flags(struct net_device *netdev, u32 data)
 #endif /* ETHTOOL_GFLAGS */
 #endif /* HAVE_NDO_SET_FEATURES */
 #ifdef ETHTOOL_GRXRINGS
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+/* Flow Director has no "queue plus RSS" action, so an RSS context is reached
+ * by steering a destination MAC into the VMDq pool backing the context.
+ * These rules share the location space with the Flow Director rules.
+ */
+static struct ixgbe_rss_ctx_rule *
+ixgbe_find_rss_ctx_rule(struct ixgbe_adapter *adapter, u32 location)
+{
+	struct ixgbe_rss_ctx_rule *rule;
+
+	hlist_for_each_entry(rule, &adapter->rss_ctx_rule_list, node)
+		if (rule->sw_idx == location)
+			return rule;
+
+	return NULL;
+}
+
+static void ixgbe_get_rss_ctx_rule(struct ixgbe_rss_ctx_rule *rule,
+				   struct ethtool_rxnfc *cmd)
+{
+	struct ethtool_rx_flow_spec *fsp = &cmd->fs;
+
+	memset(&fsp->h_u, 0, sizeof(fsp->h_u));
+	memset(&fsp->m_u, 0, sizeof(fsp->m_u));
+	fsp->flow_type = ETHER_FLOW | FLOW_RSS;
+	ether_addr_copy(fsp->h_u.ether_spec.h_dest, rule->addr);
+	eth_broadcast_addr(fsp->m_u.ether_spec.h_dest);
+	fsp->ring_cookie = 0;
+	cmd->rss_context = rule->rss_context;
+}
+
+static void ixgbe_free_rss_ctx_rule(struct ixgbe_adapter *adapter,
+				    struct ixgbe_rss_ctx_rule *rule)
+{
+	int p = ixgbe_rss_ctx_to_pool(adapter, rule->rss_context);
+
+	/* the MAC filter only exists while the interface is up */
+	if (p >= 0 && netif_running(adapter->netdev))
+		ixgbe_del_mac_filter(adapter, rule->addr, VMDQ_P(p));
+
+	hlist_del(&rule->node);
+	kfree(rule);
+	adapter->rss_ctx_rule_count--;
+}
+
+static int ixgbe_add_rss_ctx_rule(struct ixgbe_adapter *adapter,
+				  struct ethtool_rxnfc *cmd)
+{
+	struct ethtool_rx_flow_spec *fsp = &cmd->fs;
+	struct ethhdr *spec = &fsp->h_u.ether_spec;
+	struct ethhdr *mask = &fsp->m_u.ether_spec;
+	struct ixgbe_rss_ctx_rule *rule, *old = NULL;
+	struct ixgbe_fdir_filter *filter;
+	bool busy = false;
+	int p;
+
+	if ((fsp->flow_type & ~FLOW_RSS) != ETHER_FLOW) {
+		e_err(drv, "RSS context rules match a destination MAC only\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (!is_broadcast_ether_addr(mask->h_dest) ||
+	    !is_zero_ether_addr(mask->h_source) || mask->h_proto ||
+	    !is_valid_ether_addr(spec->h_dest)) {
+		e_err(drv, "RSS context rules need a full unicast destination MAC\n");
+		return -EINVAL;
+	}
+
+	/* the context's own table picks the queue */
+	if (fsp->ring_cookie) {
+		e_err(drv, "RSS context rules take no queue or drop action\n");
+		return -EINVAL;
+	}
+
+	if (ether_addr_equal(spec->h_dest, adapter->netdev->dev_addr)) {
+		e_err(drv, "The port MAC address cannot leave the main pool\n");
+		return -EINVAL;
+	}
+
+	if (fsp->location >= ((1024 << adapter->fdir_pballoc) - 2)) {
+		e_err(drv, "Location out of range\n");
+		return -EINVAL;
+	}
+
+	p = ixgbe_rss_ctx_to_pool(adapter, cmd->rss_context);
+	if (p < 0) {
+		e_err(drv, "RSS context %u has no VMDq pool\n",
+		      cmd->rss_context);
+		return -EINVAL;
+	}
+
+	spin_lock(&adapter->fdir_perfect_lock);
+	hlist_for_each_entry(filter, &adapter->fdir_filter_list, fdir_node)
+		if (filter->sw_idx == fsp->location)
+			busy = true;
+	spin_unlock(&adapter->fdir_perfect_lock);
+
+	if (busy) {
+		e_err(drv, "Location %u holds a Flow Director rule\n",
+		      fsp->location);
+		return -EBUSY;
+	}
+
+	hlist_for_each_entry(rule, &adapter->rss_ctx_rule_list, node) {
+		if (rule->sw_idx == fsp->location) {
+			old = rule;
+		} else if (ether_addr_equal(rule->addr, spec->h_dest)) {
+			e_err(drv, "MAC address already steered by rule %u\n",
+			      rule->sw_idx);
+			return -EEXIST;
+		}
+	}
+
+	rule = kzalloc(sizeof(*rule), GFP_KERNEL);
+	if (!rule)
+		return -ENOMEM;
+
+	ether_addr_copy(rule->addr, spec->h_dest);
+	rule->sw_idx = fsp->location;
+	rule->rss_context = cmd->rss_context;
+
+	if (old)
+		ixgbe_free_rss_ctx_rule(adapter, old);
+
+	/* unicast filters are restored from the rule list on open */
+	if (netif_running(adapter->netdev) &&
+	    ixgbe_add_mac_filter(adapter, rule->addr, VMDQ_P(p)) < 0) {
+		e_err(drv, "No free receive address register for the rule\n");
+		kfree(rule);
+		return -ENOSPC;
+	}
+
+	hlist_add_head(&rule->node, &adapter->rss_ctx_rule_list);
+	adapter->rss_ctx_rule_count++;
+
+	return 0;
+}
+
+#endif /* HAVE_ETHTOOL_RXFH_CONTEXT_OPS */
 static int ixgbe_get_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 					struct ethtool_rxnfc *cmd)
 {
@@ -3592,10 +3760,21 @@ static int ixgbe_get_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 		(struct ethtool_rx_flow_spec *)&cmd->fs;
 	struct hlist_node *node2;
 	struct ixgbe_fdir_filter *rule = NULL;
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	struct ixgbe_rss_ctx_rule *ctx_rule;
+#endif
 
 	/* report total rule count */
 	cmd->data = (1024 << adapter->fdir_pballoc) - 2;
 
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	ctx_rule = ixgbe_find_rss_ctx_rule(adapter, fsp->location);
+	if (ctx_rule) {
+		ixgbe_get_rss_ctx_rule(ctx_rule, cmd);
+		return 0;
+	}
+
+#endif
 	hlist_for_each_entry_safe(rule, node2,
 				  &adapter->fdir_filter_list, fdir_node) {
 		if (fsp->location <= rule->sw_idx)
@@ -3677,6 +3856,9 @@ static int ixgbe_get_ethtool_fdir_all(struct ixgbe_adapter *adapter,
 {
 	struct hlist_node *node2;
 	struct ixgbe_fdir_filter *rule;
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	struct ixgbe_rss_ctx_rule *ctx_rule;
+#endif
 	int cnt = 0;
 
 	/* report total rule count */
@@ -3690,6 +3872,15 @@ static int ixgbe_get_ethtool_fdir_all(struct ixgbe_adapter *adapter,
 		cnt++;
 	}
 
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	hlist_for_each_entry(ctx_rule, &adapter->rss_ctx_rule_list, node) {
+		if (cnt == cmd->rule_cnt)
+			return -EMSGSIZE;
+		rule_locs[cnt] = ctx_rule->sw_idx;
+		cnt++;
+	}
+#endif
+
 	cmd->rule_cnt = cnt;
 
 	return 0;
@@ -3754,6 +3945,9 @@ static int ixgbe_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd,
 		break;
 	case ETHTOOL_GRXCLSRLCNT:
 		cmd->rule_cnt = adapter->fdir_filter_count;
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+		cmd->rule_cnt += adapter->rss_ctx_rule_count;
+#endif
 		ret = 0;
 		break;
 	case ETHTOOL_GRXCLSRULE:
@@ -3773,6 +3967,26 @@ static int ixgbe_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd,
 	return ret;
 }
 
+/**
+ * ixgbe_fdir_loc_is_flower - check whether a location holds a tc flower rule
+ * @adapter: board private structure
+ * @sw_idx: filter location
+ *
+ * Flower rules share the location space with ethtool and u32 rules but are
+ * owned by tc, so the other interfaces must neither overwrite nor delete
+ * them.  Called with fdir_perfect_lock held.
+ */
+bool ixgbe_fdir_loc_is_flower(struct ixgbe_adapter *adapter, u16 sw_idx)
+{
+	struct ixgbe_fdir_filter *rule;
+
+	hlist_for_each_entry(rule, &adapter->fdir_filter_list, fdir_node)
+		if (rule->sw_idx >= sw_idx)
+			return rule->sw_idx == sw_idx && rule->cookie;
+
+	return false;
+}
+
 int ixgbe_update_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 				    struct ixgbe_fdir_filter *input,
 				    u16 sw_idx)
@@ -3813,6 +4027,8 @@ int ixgbe_update_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 		hlist_del(&rule->fdir_node);
 		kfree(rule);
 		adapter->fdir_filter_count--;
+		if (adapter->fdir_rule_map)
+			__clear_bit(sw_idx, adapter->fdir_rule_map);
 		deleted = true;
 	}
 
@@ -3836,6 +4052,12 @@ int ixgbe_update_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 	/* update counts */
 	adapter->fdir_filter_count++;
 
+	/* a new rule starts counting hits from zero */
+	if (adapter->fdir_rule_hits && sw_idx < IXGBE_FDIR_MAX_RULES) {
+		atomic64_set(&adapter->fdir_rule_hits[sw_idx], 0);
+		__set_bit(sw_idx, adapter->fdir_rule_map);
+	}
+
 	return 0;
 }
 
@@ -3948,6 +4170,14 @@ static int ixgbe_add_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 		return -EINVAL;
 	}
 
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	if (ixgbe_find_rss_ctx_rule(adapter, fsp->location)) {
+		e_err(drv, "Location %u holds an RSS context rule\n",
+		      fsp->location);
+		return -EBUSY;
+	}
+
+#endif
 	input = kzalloc(sizeof(*input), GFP_ATOMIC);
 	if (!input)
 		return -ENOMEM;
@@ -4031,6 +4261,14 @@ static int ixgbe_add_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 
 	spin_lock(&adapter->fdir_perfect_lock);
 
+	if (ixgbe_fdir_loc_is_flower(adapter, input->sw_idx)) {
+		spin_unlock(&adapter->fdir_perfect_lock);
+		e_err(drv, "Location %u holds a tc flower rule\n",
+		      input->sw_idx);
+		kfree(input);
+		return -EBUSY;
+	}
+
 	if (hlist_empty(&adapter->fdir_filter_list)) {
 		/* save mask and program input mask into HW */
 		memcpy(&adapter->fdir_mask, &mask, sizeof(mask));
@@ -4080,10 +4318,25 @@ static int ixgbe_del_ethtool_fdir_entry(struct ixgbe_adapter *adapter,
 {
 	struct ethtool_rx_flow_spec *fsp =
 		(struct ethtool_rx_flow_spec *)&cmd->fs;
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	struct ixgbe_rss_ctx_rule *rule;
+#endif
 	int err;
 
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+	rule = ixgbe_find_rss_ctx_rule(adapter, fsp->location);
+	if (rule) {
+		ixgbe_free_rss_ctx_rule(adapter, rule);
+		return 0;
+	}
+
+#endif
 	spin_lock(&adapter->fdir_perfect_lock);
-	err = ixgbe_update_ethtool_fdir_entry(adapter, NULL, fsp->location);
+	if (ixgbe_fdir_loc_is_flower(adapter, fsp->location))
+		err = -EBUSY;
+	else
+		err = ixgbe_update_ethtool_fdir_entry(adapter, NULL,
+						      fsp->location);
 	spin_unlock(&adapter->fdir_perfect_lock);
 
 	return err;
@@ -4178,10 +4431,9 @@ static int ixgbe_set_rss_hash_opt(struct ixgbe_adapter *adapter,
 	if (flags2 != adapter->flags2) {
 		struct ixgbe_hw *hw = &adapter->hw;
 		u32 mrqc;
-		unsigned int pf_pool = adapter->num_vfs;
+		unsigned int pf_pool = VMDQ_P(0);
 
-		if ((hw->mac.type >= ixgbe_mac_X550) &&
-		    (adapter->flags & IXGBE_FLAG_SRIOV_ENABLED))
+		if (ixgbe_pool_rss_enabled(adapter))
 			mrqc = IXGBE_READ_REG(hw, IXGBE_PFVFMRQC(pf_pool));
 		else
 			mrqc = IXGBE_READ_REG(hw, IXGBE_MRQC);
@@ -4208,11 +4460,16 @@ static int ixgbe_set_rss_hash_opt(struct ixgbe_adapter *adapter,
 		if (flags2 & IXGBE_FLAG2_RSS_FIELD_IPV6_UDP)
 			mrqc |= IXGBE_MRQC_RSS_FIELD_IPV6_UDP;
 
-		if ((hw->mac.type >= ixgbe_mac_X550) &&
-		    (adapter->flags & IXGBE_FLAG_SRIOV_ENABLED))
-			IXGBE_WRITE_REG(hw, IXGBE_PFVFMRQC(pf_pool), mrqc);
-		else
+		if (ixgbe_pool_rss_enabled(adapter)) {
+			int p;
+
+			/* every PF pool hashes on the same packet types */
+			for (p = 0; p < adapter->num_rx_pools; p++)
+				IXGBE_WRITE_REG(hw, IXGBE_PFVFMRQC(VMDQ_P(p)),
+						mrqc);
+		} else {
 			IXGBE_WRITE_REG(hw, IXGBE_MRQC, mrqc);
+		}
 	}
 
 	return 0;
@@ -4225,6 +4482,12 @@ static int ixgbe_set_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd)
 
 	switch (cmd->cmd) {
 	case ETHTOOL_SRXCLSRLINS:
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+		if (cmd->fs.flow_type & FLOW_RSS) {
+			ret = ixgbe_add_rss_ctx_rule(adapter, cmd);
+			break;
+		}
+#endif
 		ret = ixgbe_add_ethtool_fdir_entry(adapter, cmd);
 		break;
 	case ETHTOOL_SRXCLSRLDEL:
@@ -4342,6 +4605,10 @@ static int ixgbe_set_rxfh(struct net_device *netdev, const u32 *indir,
 #endif /* !HAVE_ETHTOOL_RXFH_PARAM */
 #endif
 
+	/* a user key would break the symmetric hash, refuse it */
+	if (key && (adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC))
+		return -EINVAL;
+
 	/* Fill out the redirection table */
 	if (indir) {
 		int max_queues = min_t(int, adapter->num_rx_queues,
@@ -4361,6 +4628,9 @@ static int ixgbe_set_rxfh(struct net_device *netdev, const u32 *indir,
 			adapter->rss_indir_tbl[i] = indir[i];
 
 		ixgbe_store_reta(adapter);
+
+		/* let a user supplied table settle before rebalancing it */
+		adapter->rss_rebal_holdoff = jiffies + IXGBE_RSS_REBAL_HOLDOFF;
 	}
 
 	/* Fill out the rss hash key */
@@ -4373,6 +4643,195 @@ static int ixgbe_set_rxfh(struct net_device *netdev, const u32 *indir,
 }
 #endif /* ETHTOOL_GRSSH && ETHTOOL_SRSSH */
 
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+/* Each additional RSS context is backed by a spare PF VMDq pool (x550 and
+ * newer), which has its own key and 64 entry redirection table.  Queue
+ * numbers within a context are relative to the pool.  Traffic reaches the
+ * pool through ETHER_FLOW rules steering a destination MAC into it.
+ */
+static int ixgbe_check_rxfh_context(struct ixgbe_adapter *adapter,
+				    struct ethtool_rxfh_context *ctx,
+				    const struct ethtool_rxfh_param *rxfh,
+				    struct netlink_ext_ack *extack)
+{
+	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
+	u32 i;
+
+	if (rxfh->hfunc != ETH_RSS_HASH_NO_CHANGE &&
+	    rxfh->hfunc != ETH_RSS_HASH_TOP) {
+		NL_SET_ERR_MSG_MOD(extack, "Only Toeplitz hashing is supported");
+		return -EOPNOTSUPP;
+	}
+
+	/* a user key would break the symmetric hash, refuse it */
+	if (rxfh->key && (adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC)) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "RSS key is fixed while rss-symmetric is set");
+		return -EINVAL;
+	}
+
+	if (rxfh->indir) {
+		for (i = 0; i < ctx->indir_size; i++) {
+			if (rxfh->indir[i] >= rss_i) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Queue index exceeds the queues per VMDq pool");
+				return -EINVAL;
+			}
+
+			/* the core sizes the table from the main context */
+			if (rxfh->indir[i] !=
+			    rxfh->indir[i % IXGBE_POOL_RETA_ENTRIES]) {
+				NL_SET_ERR_MSG_MOD(extack,
+						   "Table must repeat every 64 entries");
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void ixgbe_apply_rxfh_context(struct ixgbe_adapter *adapter, int p,
+				     struct ethtool_rxfh_context *ctx,
+				     const struct ethtool_rxfh_param *rxfh)
+{
+	struct ixgbe_pool_rss *prss = &adapter->pool_rss[p];
+	u32 i;
+
+	if (rxfh->indir)
+		for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++)
+			prss->indir[i] = rxfh->indir[i];
+
+	if (rxfh->key)
+		memcpy(prss->key, rxfh->key, IXGBE_RSS_KEY_SIZE);
+
+	/* report what the pool really uses, including driver defaults */
+	for (i = 0; i < ctx->indir_size; i++)
+		ethtool_rxfh_context_indir(ctx)[i] =
+			prss->indir[i % IXGBE_POOL_RETA_ENTRIES];
+	memcpy(ethtool_rxfh_context_key(ctx), prss->key, IXGBE_RSS_KEY_SIZE);
+	ctx->hfunc = ETH_RSS_HASH_TOP;
+
+	if (netif_running(adapter->netdev) && ixgbe_pool_rss_enabled(adapter))
+		ixgbe_setup_pool_rss(adapter, p);
+}
+
+static int ixgbe_create_rxfh_context(struct net_device *netdev,
+				     struct ethtool_rxfh_context *ctx,
+				     const struct ethtool_rxfh_param *rxfh,
+				     struct netlink_ext_ack *extack)
+{
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
+	struct ixgbe_pool_rss *prss;
+	int err, i, p;
+
+	if (!adapter->pool_rss ||
+	    !(adapter->flags & IXGBE_FLAG_VMDQ_ENABLED) ||
+	    netdev_get_num_tc(netdev) > 1) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "RSS contexts need VMDq pools on X550 or newer, without DCB");
+		return -EOPNOTSUPP;
+	}
+
+	err = ixgbe_check_rxfh_context(adapter, ctx, rxfh, extack);
+	if (err)
+		return err;
+
+	for (p = 1; p < adapter->num_rx_pools; p++)
+		if (!adapter->pool_rss[p].rss_context)
+			break;
+
+	if (p >= adapter->num_rx_pools) {
+		NL_SET_ERR_MSG_MOD(extack, "No spare VMDq pool for an RSS context");
+		return -ENOSPC;
+	}
+
+	/* start from the same spread and key as an unbound pool */
+	prss = &adapter->pool_rss[p];
+	memcpy(prss->key, adapter->rss_key, IXGBE_RSS_KEY_SIZE);
+	for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++)
+		prss->indir[i] = i % rss_i;
+	prss->rss_context = rxfh->rss_context;
+	adapter->num_rss_contexts++;
+
+	ixgbe_apply_rxfh_context(adapter, p, ctx, rxfh);
+
+	/* the first context moves the PF from the shared RETA to per-pool
+	 * RSS, which rewrites MRQC and every table
+	 */
+	if (adapter->num_rss_contexts == 1 &&
+	    !(adapter->flags & IXGBE_FLAG_SRIOV_ENABLED) &&
+	    netif_running(netdev))
+		ixgbe_do_reset(netdev);
+
+	e_info(drv, "RSS context %u uses VMDq pool %d\n",
+	       rxfh->rss_context, p);
+
+	return 0;
+}
+
+static int ixgbe_modify_rxfh_context(struct net_device *netdev,
+				     struct ethtool_rxfh_context *ctx,
+				     const struct ethtool_rxfh_param *rxfh,
+				     struct netlink_ext_ack *extack)
+{
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+	int err, p;
+
+	p = ixgbe_rss_ctx_to_pool(adapter, rxfh->rss_context);
+	if (p < 0) {
+		NL_SET_ERR_MSG_MOD(extack, "RSS context lost its VMDq pool");
+		return p;
+	}
+
+	err = ixgbe_check_rxfh_context(adapter, ctx, rxfh, extack);
+	if (err)
+		return err;
+
+	ixgbe_apply_rxfh_context(adapter, p, ctx, rxfh);
+
+	return 0;
+}
+
+static int ixgbe_remove_rxfh_context(struct net_device *netdev,
+				     struct ethtool_rxfh_context *ctx,
+				     u32 rss_context,
+				     struct netlink_ext_ack *extack)
+{
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+	struct ixgbe_rss_ctx_rule *rule;
+	int p;
+
+	hlist_for_each_entry(rule, &adapter->rss_ctx_rule_list, node) {
+		if (rule->rss_context == rss_context) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "RSS context is used by ntuple rules");
+			return -EBUSY;
+		}
+	}
+
+	/* a context that already lost its pool has nothing to release */
+	p = ixgbe_rss_ctx_to_pool(adapter, rss_context);
+	if (p < 0)
+		return 0;
+
+	/* hand the pool back to the default spread */
+	adapter->pool_rss[p].rss_context = 0;
+	adapter->num_rss_contexts--;
+
+	if (!netif_running(netdev))
+		return 0;
+
+	if (!ixgbe_pool_rss_enabled(adapter))
+		ixgbe_do_reset(netdev);
+	else
+		ixgbe_setup_pool_rss(adapter, p);
+
+	return 0;
+}
+#endif /* HAVE_ETHTOOL_RXFH_CONTEXT_OPS */
+
 #ifdef HAVE_ETHTOOL_GET_TS_INFO
 #ifdef HAVE_ETHTOOL_KERNEL_TS_INFO
 static int ixgbe_get_ts_info(struct net_device *dev,
@@ -4922,6 +5381,17 @@ static u32 ixgbe_get_priv_flags(struct net_device *netdev)
 	if (adapter->flags2 & IXGBE_FLAG2_AUTO_DISABLE_VF)
 		priv_flags |= IXGBE_PRIV_FLAGS_AUTO_DISABLE_VF;
 
+	if (adapter->flags2 & IXGBE_FLAG2_RSS_REBALANCE)
+		priv_flags |= IXGBE_PRIV_FLAGS_RSS_REBALANCE;
+
+	if (adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC)
+		priv_flags |= IXGBE_PRIV_FLAGS_RSS_SYMMETRIC;
+#ifdef HAVE_PTP_1588_CLOCK
+
+	if (adapter->flags2 & IXGBE_FLAG2_RX_TSTAMP_APPROX)
+		priv_flags |= IXGBE_PRIV_FLAGS_RX_TSTAMP_APPROX;
+#endif
+
 	return priv_flags;
 }
 
@@ -4978,6 +5448,48 @@ static int ixgbe_set_priv_flags(struct net_device *netdev, u32 priv_flags)
 			return -EOPNOTSUPP;
 		}
 	}
+#ifdef HAVE_PTP_1588_CLOCK
+
+	/* lets 82599 and X540 accept HWTSTAMP_FILTER_ALL, takes effect on
+	 * the next SIOCSHWTSTAMP and needs no reset
+	 */
+	if (priv_flags & IXGBE_PRIV_FLAGS_RX_TSTAMP_APPROX) {
+		if (adapter->hw.mac.type != ixgbe_mac_82599EB &&
+		    adapter->hw.mac.type != ixgbe_mac_X540) {
+			e_info(probe,
+			       "Cannot set private flags: Operation not supported\n");
+			return -EOPNOTSUPP;
+		}
+		adapter->flags2 |= IXGBE_FLAG2_RX_TSTAMP_APPROX;
+	} else {
+		adapter->flags2 &= ~IXGBE_FLAG2_RX_TSTAMP_APPROX;
+	}
+	flags2 &= ~IXGBE_FLAG2_RX_TSTAMP_APPROX;
+	flags2 |= adapter->flags2 & IXGBE_FLAG2_RX_TSTAMP_APPROX;
+#endif
+
+	/* the RETA rebalancer runs from the service task and needs no reset */
+	if (priv_flags & IXGBE_PRIV_FLAGS_RSS_REBALANCE) {
+		if (!(adapter->flags2 & IXGBE_FLAG2_RSS_REBALANCE))
+			adapter->rss_rebal_holdoff = jiffies +
+						     IXGBE_RSS_REBAL_HOLDOFF;
+		adapter->flags2 |= IXGBE_FLAG2_RSS_REBALANCE;
+	} else {
+		adapter->flags2 &= ~IXGBE_FLAG2_RSS_REBALANCE;
+	}
+	flags2 &= ~IXGBE_FLAG2_RSS_REBALANCE;
+	flags2 |= adapter->flags2 & IXGBE_FLAG2_RSS_REBALANCE;
+
+	/* switching the hash key takes effect immediately */
+	if (!!(priv_flags & IXGBE_PRIV_FLAGS_RSS_SYMMETRIC) !=
+	    !!(adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC)) {
+		adapter->flags2 ^= IXGBE_FLAG2_RSS_SYMMETRIC;
+		ixgbe_fill_rss_key(adapter, adapter->rss_key);
+		if (netif_running(netdev))
+			ixgbe_store_key(adapter);
+	}
+	flags2 &= ~IXGBE_FLAG2_RSS_SYMMETRIC;
+	flags2 |= adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC;
 
 	if (flags != adapter->flags) {
 		adapter->flags = flags;
@@ -5103,6 +5615,19 @@ static struct ethtool_ops ixgbe_ethtool_ops = {
 	.get_rxfh		= ixgbe_get_rxfh,
 	.set_rxfh		= ixgbe_set_rxfh,
 #endif /* ETHTOOL_GRSSH && ETHTOOL_SRSSH */
+#ifdef HAVE_ETHTOOL_RXFH_CONTEXT_OPS
+#ifdef HAVE_ETHTOOL_RXFH_PER_CTX_KEY
+	.rxfh_per_ctx_key	= 1,
+#endif
+#ifdef HAVE_ETHTOOL_RXFH_MAX_NUM_CONTEXTS
+	.rxfh_max_num_contexts	= IXGBE_MAX_VMDQ_INDICES,
+#else
+	.rxfh_max_context_id	= IXGBE_MAX_VMDQ_INDICES,
+#endif
+	.create_rxfh_context	= ixgbe_create_rxfh_context,
+	.modify_rxfh_context	= ixgbe_modify_rxfh_context,
+	.remove_rxfh_context	= ixgbe_remove_rxfh_context,
+#endif /* HAVE_ETHTOOL_RXFH_CONTEXT_OPS */
 #endif /* HAVE_RHEL6_ETHTOOL_OPS_EXT_STRUCT */
 };
 
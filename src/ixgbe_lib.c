@@ -1345,6 +1345,9 @@ int ixgbe_init_interrupt_scheme(struct ixgbe_adapter *adapter)
 	/* Set interrupt mode */
 	ixgbe_set_interrupt_capability(adapter);
 
+	/* RSS contexts only keep pools that survived the new layout */
+	ixgbe_rss_ctx_prune(adapter);
+
 	/* Allocate memory for queues */
 	err = ixgbe_alloc_q_vectors(adapter);
 	if (err) {
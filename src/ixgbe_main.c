@@ -169,6 +169,7 @@ static struct notifier_block dca_notifier = {
 static void ixgbe_watchdog_link_is_down(struct ixgbe_adapter *);
 static void ixgbe_watchdog_link_is_up(struct ixgbe_adapter *);
 static void ixgbe_watchdog_update_link(struct ixgbe_adapter *);
+static void ixgbe_harvest_stats(struct ixgbe_adapter *adapter, bool all);
 
 MODULE_AUTHOR("Intel Corporation, <linux.nics@intel.com>");
 MODULE_DESCRIPTION(DRV_SUMMARY);
@@ -347,6 +348,33 @@ static void ixgbe_service_event_complete(struct ixgbe_adapter *adapter)
 	clear_bit(__IXGBE_SERVICE_SCHED, adapter->state);
 }
 
+static void ixgbe_subtask_account(struct ixgbe_subtask *st, u64 start)
+{
+	u64 ns = ktime_get_ns() - start;
+
+	st->last_ns = ns;
+	st->total_ns += ns;
+	st->max_ns = max(st->max_ns, ns);
+	st->runs++;
+}
+
+/* the service task is started by service_timer, not here */
+static void ixgbe_subtasks_start(struct ixgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = IXGBE_SUBTASK_SERVICE + 1; i < IXGBE_SUBTASK_NUM; i++)
+		schedule_delayed_work(&adapter->subtasks[i].work, 0);
+}
+
+static void ixgbe_subtasks_stop(struct ixgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = IXGBE_SUBTASK_SERVICE + 1; i < IXGBE_SUBTASK_NUM; i++)
+		cancel_delayed_work_sync(&adapter->subtasks[i].work);
+}
+
 static void ixgbe_remove_adapter(struct ixgbe_hw *hw)
 {
 	struct ixgbe_adapter *adapter = hw->back;
@@ -940,6 +968,7 @@ static bool ixgbe_clean_tx_irq(struct ixgbe_q_vector *q_vector,
 	unsigned int total_bytes = 0, total_packets = 0;
 	unsigned int budget = q_vector->tx.work_limit;
 	unsigned int i = tx_ring->next_to_clean;
+	unsigned int ntc = i;
 
 	if (test_bit(__IXGBE_DOWN, adapter->state))
 		return true;
@@ -1038,6 +1067,8 @@ static bool ixgbe_clean_tx_irq(struct ixgbe_q_vector *q_vector,
 	u64_stats_update_end(&tx_ring->syncp);
 	q_vector->tx.total_bytes += total_bytes;
 	q_vector->tx.total_packets += total_packets;
+	ixgbe_hist_add(q_vector, IXGBE_HIST_TX_DESCS,
+		       (i < ntc ? i + tx_ring->count : i) - ntc);
 
 	if (check_for_tx_hang(tx_ring) && ixgbe_check_tx_hang(tx_ring)) {
 		if (adapter->hw.mac.type == ixgbe_mac_E610)
@@ -1702,6 +1733,67 @@ static void ixgbe_rx_vlan(struct ixgbe_ring *ring,
 #endif
 }
 
+/**
+ * ixgbe_fdir_flush_hits - Credit batched Flow Director hits to their rule
+ * @rx_ring: rx descriptor ring the hits were seen on
+ *
+ * Perfect filter hits are batched per ring while the same filter keeps
+ * matching, so the shared per-rule counter is only touched once per run.
+ **/
+void ixgbe_fdir_flush_hits(struct ixgbe_ring *rx_ring)
+{
+	struct ixgbe_adapter *adapter = rx_ring->q_vector->adapter;
+	struct ixgbe_rx_queue_stats *rx_stats = &rx_ring->rx_stats;
+
+	if (!rx_stats->fdir_run)
+		return;
+
+	if (!adapter->fdir_rule_hits) {
+		/* counters not allocated, nothing to credit */
+	} else if (rx_stats->fdir_run_idx < IXGBE_FDIR_MAX_RULES &&
+		   test_bit(rx_stats->fdir_run_idx, adapter->fdir_rule_map)) {
+		atomic64_add(rx_stats->fdir_run,
+			     &adapter->fdir_rule_hits[rx_stats->fdir_run_idx]);
+	} else {
+		/* the index must name a programmed filter, count it apart */
+		atomic64_add(rx_stats->fdir_run, &adapter->fdir_stray_hits);
+	}
+
+	rx_stats->fdir_run = 0;
+}
+
+/**
+ * ixgbe_rx_fdir_hit - Account a Flow Director match on an Rx descriptor
+ * @rx_ring: rx descriptor ring packet is being transacted on
+ * @rx_desc: pointer to the EOP Rx descriptor
+ *
+ * With perfect filters the lower 16 bits of the filter ID field hold the
+ * software index (rule location) of the matching filter, the upper 16 bits
+ * hold its bucket hash.
+ **/
+static inline void ixgbe_rx_fdir_hit(struct ixgbe_ring *rx_ring,
+				     union ixgbe_adv_rx_desc *rx_desc)
+{
+	struct ixgbe_rx_queue_stats *rx_stats = &rx_ring->rx_stats;
+	u16 idx;
+
+	if (!ixgbe_test_staterr(rx_desc, IXGBE_RXDADV_STAT_FLM))
+		return;
+
+	rx_stats->fdir_match++;
+
+	if (!(rx_ring->q_vector->adapter->flags &
+	      IXGBE_FLAG_FDIR_PERFECT_CAPABLE))
+		return;
+
+	idx = le16_to_cpu(rx_desc->wb.lower.hi_dword.csum_ip.ip_id);
+	if (rx_stats->fdir_run && rx_stats->fdir_run_idx != idx)
+		ixgbe_fdir_flush_hits(rx_ring);
+
+	rx_stats->fdir_run_idx = idx;
+	rx_stats->fdir_run++;
+}
+
 /**
  * ixgbe_process_skb_fields - Populate skb header fields from Rx descriptor
  * @rx_ring: rx descriptor ring packet is being transacted on
@@ -1721,6 +1813,7 @@ void ixgbe_process_skb_fields(struct ixgbe_ring *rx_ring,
 
 #endif
 	ixgbe_update_rsc_stats(rx_ring, skb);
+	ixgbe_rx_fdir_hit(rx_ring, rx_desc);
 
 #ifdef NETIF_F_RXHASH
 	ixgbe_rx_hash(rx_ring, rx_desc, skb);
@@ -2566,12 +2659,15 @@ static int ixgbe_clean_rx_irq(struct ixgbe_q_vector *q_vector,
 		ixgbe_xdp_ring_update_tail_locked(ring);
 	}
 
+	ixgbe_fdir_flush_hits(rx_ring);
+
 	u64_stats_update_begin(&rx_ring->syncp);
 	rx_ring->stats.packets += total_rx_packets;
 	rx_ring->stats.bytes += total_rx_bytes;
 	u64_stats_update_end(&rx_ring->syncp);
 	q_vector->rx.total_packets += total_rx_packets;
 	q_vector->rx.total_bytes += total_rx_bytes;
+	ixgbe_hist_add(q_vector, IXGBE_HIST_RX_PKTS, total_rx_packets);
 
 	return total_rx_packets;
 }
@@ -2720,10 +2816,13 @@ static int ixgbe_clean_rx_irq(struct ixgbe_q_vector *q_vector,
 		total_rx_packets++;
 	}
 
+	ixgbe_fdir_flush_hits(rx_ring);
+
 	rx_ring->stats.packets += total_rx_packets;
 	rx_ring->stats.bytes += total_rx_bytes;
 	q_vector->rx.total_packets += total_rx_packets;
 	q_vector->rx.total_bytes += total_rx_bytes;
+	ixgbe_hist_add(q_vector, IXGBE_HIST_RX_PKTS, total_rx_packets);
 
 	if (cleaned_count)
 		ixgbe_alloc_rx_buffers(rx_ring, cleaned_count);
@@ -2748,6 +2847,11 @@ static int ixgbe_busy_poll_recv(struct napi_struct *napi)
 	if (!ixgbe_qv_lock_poll(q_vector))
 		return LL_FLUSH_BUSY;
 
+#ifdef HAVE_PTP_1588_CLOCK
+	/* don't reuse the SYSTIME sample of an earlier NAPI poll */
+	q_vector->rx_tstamp_ns = 0;
+
+#endif
 	ixgbe_for_each_ring(ring, q_vector->rx) {
 		found = ixgbe_clean_rx_irq(q_vector, ring, 4);
 #ifdef BP_EXTENDED_STATS
@@ -3956,6 +4060,7 @@ static irqreturn_t ixgbe_msix_other(int __always_unused irq, void *data)
 {
 	struct ixgbe_adapter *adapter = data;
 	struct ixgbe_hw *hw = &adapter->hw;
+	irqreturn_t ret = IRQ_HANDLED;
 	u32 eicr;
 
 	/*
@@ -3980,8 +4085,9 @@ static irqreturn_t ixgbe_msix_other(int __always_unused irq, void *data)
 	if (eicr & IXGBE_EICR_LSC)
 		ixgbe_check_lsc(adapter);
 
+	/* VF mailbox events are handled in the IRQ thread */
 	if (eicr & IXGBE_EICR_MAILBOX)
-		ixgbe_msg_task(adapter);
+		ret = IRQ_WAKE_THREAD;
 	if (eicr & IXGBE_EICR_FW_EVENT)
 		ixgbe_schedule_fw_event(adapter);
 
@@ -4043,13 +4149,31 @@ static irqreturn_t ixgbe_msix_other(int __always_unused irq, void *data)
 
 #ifdef HAVE_PTP_1588_CLOCK
 	if (unlikely(eicr & IXGBE_EICR_TIMESYNC))
-	    ixgbe_ptp_check_pps_event(adapter);
+		ixgbe_ptp_check_pps_event(adapter);
 #endif
 
 	/* re-enable the original interrupt state, no lsc, no queues */
 	if (!test_bit(__IXGBE_DOWN, adapter->state))
 		ixgbe_irq_enable(adapter, false, false);
 
+	return ret;
+}
+
+/**
+ * ixgbe_msix_other_thread - Threaded half of the misc interrupt
+ * @irq: interrupt number
+ * @data: pointer to the adapter structure
+ *
+ * Services the VF mailboxes outside of hard IRQ context. The thread is
+ * woken once per mailbox interrupt and handles only the VFs whose bits
+ * are set, so a burst from many VFs does not stretch the hard handler.
+ **/
+static irqreturn_t ixgbe_msix_other_thread(int __always_unused irq, void *data)
+{
+	struct ixgbe_adapter *adapter = data;
+
+	ixgbe_msg_task(adapter);
+
 	return IRQ_HANDLED;
 }
 
@@ -4059,8 +4183,10 @@ static irqreturn_t ixgbe_msix_clean_rings(int __always_unused irq, void *data)
 
 	/* EIAM disabled interrupts (on this vector) for us */
 
-	if (q_vector->rx.ring || q_vector->tx.ring)
+	if (q_vector->rx.ring || q_vector->tx.ring) {
+		ixgbe_hist_irq(q_vector);
 		napi_schedule_irqoff(&q_vector->napi);
+	}
 
 	return IRQ_HANDLED;
 }
@@ -4081,6 +4207,8 @@ int ixgbe_poll(struct napi_struct *napi, int budget)
 	int per_ring_budget, work_done = 0;
 	bool clean_complete = true;
 
+	ixgbe_hist_poll(q_vector);
+
 #if IS_ENABLED(CONFIG_DCA)
 	if (adapter->flags & IXGBE_FLAG_DCA_ENABLED)
 		ixgbe_update_dca(q_vector);
@@ -4111,6 +4239,11 @@ int ixgbe_poll(struct napi_struct *napi, int budget)
 		return budget;
 #endif
 
+#ifdef HAVE_PTP_1588_CLOCK
+	/* approximate Rx timestamps read SYSTIME again for each poll */
+	q_vector->rx_tstamp_ns = 0;
+
+#endif
 	/* attempt to distribute budget to each queue fairly, but don't allow
 	 * the budget to go below 1 because we'll exit polling */
 	if (q_vector->rx.count > 1)
@@ -4197,8 +4330,9 @@ static int ixgbe_request_msix_irqs(struct ixgbe_adapter *adapter)
 		}
 	}
 
-	err = request_irq(adapter->msix_entries[vector].vector,
-			  ixgbe_msix_other, 0, netdev->name, adapter);
+	err = request_threaded_irq(adapter->msix_entries[vector].vector,
+				   ixgbe_msix_other, ixgbe_msix_other_thread,
+				   0, netdev->name, adapter);
 	if (err) {
 		e_err(probe, "request_irq for msix_other failed: %d\n", err);
 		goto free_queue_irqs;
@@ -4286,10 +4420,11 @@ static irqreturn_t ixgbe_intr(int __always_unused irq, void *data)
 	ixgbe_check_fan_failure(adapter, eicr);
 #ifdef HAVE_PTP_1588_CLOCK
 	if (unlikely(eicr & IXGBE_EICR_TIMESYNC))
-	    ixgbe_ptp_check_pps_event(adapter);
+		ixgbe_ptp_check_pps_event(adapter);
 #endif
 
 	/* would disable interrupts here but EIAM disabled it */
+	ixgbe_hist_irq(q_vector);
 	napi_schedule_irqoff(&q_vector->napi);
 
 	/*
@@ -4478,9 +4613,14 @@ void ixgbe_configure_tx_ring(struct ixgbe_adapter *adapter,
 	if (adapter->flags & IXGBE_FLAG_FDIR_HASH_CAPABLE) {
 		ring->atr_sample_rate = adapter->atr_sample_rate;
 		ring->atr_count = 0;
+		ring->atr_udp_sample_rate = adapter->atr_udp_sample_rate;
+		ring->atr_udp_count = 0;
+		ring->atr_udp_window = jiffies;
+		ring->atr_udp_admitted = 0;
 		set_bit(__IXGBE_TX_FDIR_INIT_DONE, &ring->state);
 	} else {
 		ring->atr_sample_rate = 0;
+		ring->atr_udp_sample_rate = 0;
 	}
 
 	/* initialize XPS */
@@ -4733,15 +4873,15 @@ static void ixgbe_configure_srrctl(struct ixgbe_adapter *adapter,
  * ixgbe_rss_indir_tbl_entries - Return RSS indirection table entries
  * @adapter: device handle
  *
- *  - 82598/82599/X540:     128
- *  - X550(non-SRIOV mode): 512
- *  - X550(SRIOV mode):     64
+ *  - 82598/82599/X540:       128
+ *  - X550(non-VMDq mode):    512
+ *  - X550(VMDq/SRIOV mode):  64
  */
 u32 ixgbe_rss_indir_tbl_entries(struct ixgbe_adapter *adapter)
 {
 	if (adapter->hw.mac.type < ixgbe_mac_X550)
 		return 128;
-	else if (adapter->flags & IXGBE_FLAG_SRIOV_ENABLED)
+	else if (ixgbe_pool_rss_enabled(adapter))
 		return 64;
 	else
 		return 512;
@@ -4758,10 +4898,56 @@ void ixgbe_store_key(struct ixgbe_adapter *adapter)
 	struct ixgbe_hw *hw = &adapter->hw;
 	int i;
 
+	/* x550 in VMDq mode hashes PF traffic with the PF pools' keys */
+	if (ixgbe_pool_rss_enabled(adapter)) {
+		unsigned int pf_pool = VMDQ_P(0);
+		u16 p;
+
+		for (i = 0; i < 10; i++)
+			IXGBE_WRITE_REG(hw, IXGBE_PFVFRSSRK(i, pf_pool),
+					adapter->rss_key[i]);
+
+		/* pools not bound to an RSS context follow the main key */
+		for (p = 1; p < adapter->num_rx_pools; p++) {
+			struct ixgbe_pool_rss *prss = &adapter->pool_rss[p];
+
+			if (prss->rss_context)
+				continue;
+
+			memcpy(prss->key, adapter->rss_key, IXGBE_RSS_KEY_SIZE);
+			for (i = 0; i < 10; i++)
+				IXGBE_WRITE_REG(hw, IXGBE_PFVFRSSRK(i, VMDQ_P(p)),
+						prss->key[i]);
+		}
+		return;
+	}
+
 	for (i = 0; i < 10; i++)
 		IXGBE_WRITE_REG(hw, IXGBE_RSSRK(i), adapter->rss_key[i]);
 }
 
+/**
+ * ixgbe_fill_rss_key - Generate the RSS key for the current hash mode
+ * @adapter: device handle
+ * @rss_key: buffer of IXGBE_RSS_KEY_SIZE bytes to fill
+ *
+ * In symmetric mode the key repeats a 16-bit pattern.  The Toeplitz hash
+ * then yields the same value when source and destination addresses and
+ * ports are swapped, so both directions of a flow land on the same queue.
+ **/
+void ixgbe_fill_rss_key(struct ixgbe_adapter *adapter, u32 *rss_key)
+{
+	int i;
+
+	if (adapter->flags2 & IXGBE_FLAG2_RSS_SYMMETRIC) {
+		for (i = 0; i < IXGBE_RSS_KEY_SIZE / 4; i++)
+			rss_key[i] = IXGBE_RSS_SYM_KEY_WORD;
+		return;
+	}
+
+	netdev_rss_key_fill(rss_key, IXGBE_RSS_KEY_SIZE);
+}
+
 /**
  * ixgbe_init_rss_key - Initialize adapter RSS key
  * @adapter: device handle
@@ -4777,13 +4963,37 @@ static inline int ixgbe_init_rss_key(struct ixgbe_adapter *adapter)
 		if (unlikely(!rss_key))
 			return -ENOMEM;
 
-		netdev_rss_key_fill(rss_key, IXGBE_RSS_KEY_SIZE);
+		ixgbe_fill_rss_key(adapter, rss_key);
 		adapter->rss_key = rss_key;
 	}
 
 	return 0;
 }
 
+/**
+ * ixgbe_store_vfreta - Write the RETA table to HW (x550 devices in VMDq mode)
+ * @adapter: device handle
+ *
+ * Write the RSS redirection table stored in adapter.rss_indir_tbl[] to HW.
+ */
+static void ixgbe_store_vfreta(struct ixgbe_adapter *adapter)
+{
+	u32 i, reta_entries = ixgbe_rss_indir_tbl_entries(adapter);
+	struct ixgbe_hw *hw = &adapter->hw;
+	u32 vfreta = 0;
+	unsigned int pf_pool = VMDQ_P(0);
+
+	/* Write redirection table to HW */
+	for (i = 0; i < reta_entries; i++) {
+		vfreta |= (u32)adapter->rss_indir_tbl[i] << (i & 0x3) * 8;
+		if ((i & 3) == 3) {
+			IXGBE_WRITE_REG(hw, IXGBE_PFVFRETA(i >> 2, pf_pool),
+					vfreta);
+			vfreta = 0;
+		}
+	}
+}
+
 /**
  * ixgbe_store_reta - Write the RETA table to HW
  * @adapter: device handle
@@ -4798,6 +5008,11 @@ void ixgbe_store_reta(struct ixgbe_adapter *adapter)
 	u32 indices_multi;
 	u8 *indir_tbl = adapter->rss_indir_tbl;
 
+	if (ixgbe_pool_rss_enabled(adapter)) {
+		ixgbe_store_vfreta(adapter);
+		return;
+	}
+
 	/* Fill out the redirection table as follows:
 	 *  - 82598:      8 bit wide entries containing pair of 4 bit RSS
 	 *    indices.
@@ -4824,27 +5039,34 @@ void ixgbe_store_reta(struct ixgbe_adapter *adapter)
 }
 
 /**
- * ixgbe_store_vfreta - Write the RETA table to HW (x550 devices in SRIOV mode)
+ * ixgbe_store_reta_entry - Write the RETA register holding one entry
  * @adapter: device handle
+ * @idx: index into adapter.rss_indir_tbl[] that changed
  *
- * Write the RSS redirection table stored in adapter.rss_indir_tbl[] to HW.
+ * Each 32-bit RETA/ERETA register holds four table entries, so only the
+ * register covering @idx needs to be rewritten.
  */
-static void ixgbe_store_vfreta(struct ixgbe_adapter *adapter)
+static void ixgbe_store_reta_entry(struct ixgbe_adapter *adapter, u32 idx)
 {
-	u32 i, reta_entries = ixgbe_rss_indir_tbl_entries(adapter);
 	struct ixgbe_hw *hw = &adapter->hw;
-	u32 vfreta = 0;
-	unsigned int pf_pool = adapter->num_vfs;
+	u8 *indir_tbl = adapter->rss_indir_tbl;
+	u32 base = idx & ~0x3;
+	u32 indices_multi;
+	u32 reta = 0;
+	u32 i;
 
-	/* Write redirection table to HW */
-	for (i = 0; i < reta_entries; i++) {
-		vfreta |= (u32)adapter->rss_indir_tbl[i] << (i & 0x3) * 8;
-		if ((i & 3) == 3) {
-			IXGBE_WRITE_REG(hw, IXGBE_PFVFRETA(i >> 2, pf_pool),
-					vfreta);
-			vfreta = 0;
-		}
-	}
+	if (hw->mac.type == ixgbe_mac_82598EB)
+		indices_multi = 0x11;
+	else
+		indices_multi = 0x1;
+
+	for (i = 0; i < 4; i++)
+		reta |= indices_multi * indir_tbl[base + i] << i * 8;
+
+	if (base < 128)
+		IXGBE_WRITE_REG(hw, IXGBE_RETA(base >> 2), reta);
+	else
+		IXGBE_WRITE_REG(hw, IXGBE_ERETA((base >> 2) - 32), reta);
 }
 
 static void ixgbe_setup_reta(struct ixgbe_adapter *adapter)
@@ -4874,19 +5096,18 @@ static void ixgbe_setup_reta(struct ixgbe_adapter *adapter)
 	}
 
 	ixgbe_store_reta(adapter);
+
+	/* restart load sampling against the freshly built table */
+	adapter->rss_rebal_holdoff = jiffies + IXGBE_RSS_REBAL_HOLDOFF;
 }
 
 static void ixgbe_setup_vfreta(struct ixgbe_adapter *adapter)
 {
-	struct ixgbe_hw *hw = &adapter->hw;
 	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
-	unsigned int pf_pool = adapter->num_vfs;
 	int i, j;
 
 	/* Fill out hash function seeds */
-	for (i = 0; i < 10; i++)
-		IXGBE_WRITE_REG(hw, IXGBE_PFVFRSSRK(i, pf_pool),
-				*(adapter->rss_key + i));
+	ixgbe_store_key(adapter);
 
 	/* Fill out the redirection table */
 	for (i = 0, j = 0; i < 64; i++, j++) {
@@ -4899,6 +5120,155 @@ static void ixgbe_setup_vfreta(struct ixgbe_adapter *adapter)
 	ixgbe_store_vfreta(adapter);
 }
 
+static u32 ixgbe_rss_field(struct ixgbe_adapter *adapter)
+{
+	u32 rss_field;
+
+	/* Perform hash on these packet types */
+	rss_field = IXGBE_MRQC_RSS_FIELD_IPV4 |
+		     IXGBE_MRQC_RSS_FIELD_IPV4_TCP |
+		     IXGBE_MRQC_RSS_FIELD_IPV6 |
+		     IXGBE_MRQC_RSS_FIELD_IPV6_TCP;
+
+	if (adapter->flags2 & IXGBE_FLAG2_RSS_FIELD_IPV4_UDP)
+		rss_field |= IXGBE_MRQC_RSS_FIELD_IPV4_UDP;
+	if (adapter->flags2 & IXGBE_FLAG2_RSS_FIELD_IPV6_UDP)
+		rss_field |= IXGBE_MRQC_RSS_FIELD_IPV6_UDP;
+
+	return rss_field;
+}
+
+/**
+ * ixgbe_setup_pool_rss - Program RSS for an additional PF pool
+ * @adapter: device handle
+ * @p: PF pool index, 1 to num_rx_pools - 1
+ *
+ * A pool backing an ethtool RSS context is programmed with the context's
+ * key and table.  Any other pool spreads over its queues with the main key.
+ */
+void ixgbe_setup_pool_rss(struct ixgbe_adapter *adapter, u16 p)
+{
+	struct ixgbe_pool_rss *prss = &adapter->pool_rss[p];
+	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
+	struct ixgbe_hw *hw = &adapter->hw;
+	unsigned int pool = VMDQ_P(p);
+	u32 vfreta = 0;
+	int i;
+
+	if (!prss->rss_context) {
+		memcpy(prss->key, adapter->rss_key, IXGBE_RSS_KEY_SIZE);
+		for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++)
+			prss->indir[i] = i % rss_i;
+	}
+
+	for (i = 0; i < 10; i++)
+		IXGBE_WRITE_REG(hw, IXGBE_PFVFRSSRK(i, pool), prss->key[i]);
+
+	for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++) {
+		vfreta |= (u32)prss->indir[i] << (i & 0x3) * 8;
+		if ((i & 3) == 3) {
+			IXGBE_WRITE_REG(hw, IXGBE_PFVFRETA(i >> 2, pool),
+					vfreta);
+			vfreta = 0;
+		}
+	}
+
+	IXGBE_WRITE_REG(hw, IXGBE_PFVFMRQC(pool),
+			IXGBE_MRQC_RSSEN | ixgbe_rss_field(adapter));
+}
+
+/**
+ * ixgbe_rss_ctx_to_pool - Find the PF pool backing an ethtool RSS context
+ * @adapter: device handle
+ * @rss_context: ethtool RSS context id
+ *
+ * Returns the pool index, or -ENOENT if the context has no pool
+ */
+int ixgbe_rss_ctx_to_pool(struct ixgbe_adapter *adapter, u32 rss_context)
+{
+	u16 p;
+
+	if (!adapter->pool_rss || !rss_context)
+		return -ENOENT;
+
+	for (p = 1; p < adapter->num_rx_pools; p++)
+		if (adapter->pool_rss[p].rss_context == rss_context)
+			return p;
+
+	return -ENOENT;
+}
+
+/**
+ * ixgbe_rss_ctx_prune - Unbind RSS contexts from pools that went away
+ * @adapter: device handle
+ *
+ * Called once the queue layout has been recomputed.  A context whose pool
+ * is beyond num_rx_pools, or any context once DCB or the loss of VMDq takes
+ * the pools away from RSS, is unbound.  Its rules stay listed but steer
+ * nothing.  A table naming queues the pool no longer has is respread.
+ */
+void ixgbe_rss_ctx_prune(struct ixgbe_adapter *adapter)
+{
+	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
+	bool usable;
+	u16 p;
+	int i;
+
+	if (!adapter->pool_rss || !adapter->num_rss_contexts)
+		return;
+
+	usable = (adapter->flags & IXGBE_FLAG_VMDQ_ENABLED) &&
+		 netdev_get_num_tc(adapter->netdev) <= 1;
+
+	for (p = 1; p < IXGBE_MAX_VMDQ_INDICES; p++) {
+		struct ixgbe_pool_rss *prss = &adapter->pool_rss[p];
+
+		if (!prss->rss_context)
+			continue;
+
+		if (!usable || p >= adapter->num_rx_pools) {
+			e_warn(drv, "RSS context %u lost VMDq pool %u\n",
+			       prss->rss_context, p);
+			prss->rss_context = 0;
+			adapter->num_rss_contexts--;
+			continue;
+		}
+
+		for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++)
+			if (prss->indir[i] >= rss_i)
+				break;
+
+		if (i < IXGBE_POOL_RETA_ENTRIES)
+			for (i = 0; i < IXGBE_POOL_RETA_ENTRIES; i++)
+				prss->indir[i] = i % rss_i;
+	}
+}
+
+/**
+ * ixgbe_rss_ctx_rule_restore - Reinstall the MAC filters of RSS context rules
+ * @adapter: device handle
+ *
+ * A reset flushes the MAC table, so each destination MAC steered into an RSS
+ * context goes back into its pool.  Rules whose context lost its pool are
+ * left out.
+ */
+static void ixgbe_rss_ctx_rule_restore(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_rss_ctx_rule *rule;
+	int p;
+
+	hlist_for_each_entry(rule, &adapter->rss_ctx_rule_list, node) {
+		p = ixgbe_rss_ctx_to_pool(adapter, rule->rss_context);
+		if (p < 0)
+			continue;
+
+		/* drop any copy that survived without a reset */
+		ixgbe_del_mac_filter(adapter, rule->addr, VMDQ_P(p));
+		if (ixgbe_add_mac_filter(adapter, rule->addr, VMDQ_P(p)) < 0)
+			e_warn(drv, "No RAR left for RSS context %u rule %u\n",
+			       rule->rss_context, rule->sw_idx);
+	}
+}
 
 static void ixgbe_setup_mrqc(struct ixgbe_adapter *adapter)
 {
@@ -4941,20 +5311,11 @@ static void ixgbe_setup_mrqc(struct ixgbe_adapter *adapter)
 		mrqc |= IXGBE_MRQC_L3L4TXSWEN;
 	}
 
-	/* Perform hash on these packet types */
-	rss_field = IXGBE_MRQC_RSS_FIELD_IPV4 |
-		     IXGBE_MRQC_RSS_FIELD_IPV4_TCP |
-		     IXGBE_MRQC_RSS_FIELD_IPV6 |
-		     IXGBE_MRQC_RSS_FIELD_IPV6_TCP;
-
-	if (adapter->flags2 & IXGBE_FLAG2_RSS_FIELD_IPV4_UDP)
-		rss_field |= IXGBE_MRQC_RSS_FIELD_IPV4_UDP;
-	if (adapter->flags2 & IXGBE_FLAG2_RSS_FIELD_IPV6_UDP)
-		rss_field |= IXGBE_MRQC_RSS_FIELD_IPV6_UDP;
+	rss_field = ixgbe_rss_field(adapter);
 
-	if ((hw->mac.type >= ixgbe_mac_X550) &&
-	    (adapter->flags & IXGBE_FLAG_SRIOV_ENABLED)) {
-		unsigned int pf_pool = adapter->num_vfs;
+	if (ixgbe_pool_rss_enabled(adapter)) {
+		unsigned int pf_pool = VMDQ_P(0);
+		u16 p;
 
 		/* Enable VF RSS mode */
 		mrqc |= IXGBE_MRQC_MULTIPLE_RSS;
@@ -4965,6 +5326,10 @@ static void ixgbe_setup_mrqc(struct ixgbe_adapter *adapter)
 		vfmrqc = IXGBE_MRQC_RSSEN;
 		vfmrqc |= rss_field;
 		IXGBE_WRITE_REG(hw, IXGBE_PFVFMRQC(pf_pool), vfmrqc);
+
+		/* remaining PF pools, including any backing RSS contexts */
+		for (p = 1; p < adapter->num_rx_pools; p++)
+			ixgbe_setup_pool_rss(adapter, p);
 	} else {
 		ixgbe_setup_reta(adapter);
 		mrqc |= rss_field;
@@ -6096,39 +6461,158 @@ static u8 *ixgbe_addr_list_itr(struct ixgbe_hw __maybe_unused *hw, u8 **mc_addr_
 }
 
 /**
- * ixgbe_write_mc_addr_list - write multicast addresses to MTA
- * @netdev: network interface device structure
+ * ixgbe_mta_get - take a reference on a multicast hash bit
+ * @adapter: pointer to private adapter struct
+ * @vector: 12 bit MTA hash
  *
- * Writes multicast address list to the MTA hash table.
- * Returns: -ENOMEM on failure
- *                0 on no addresses written
- *                X on writing X addresses to MTA
+ * The PF and every VF hold one reference per hash they want.  Only the
+ * first reference changes the table, the register is marked for the next
+ * ixgbe_mta_flush().  Called with mta_lock held.
  **/
-int ixgbe_write_mc_addr_list(struct net_device *netdev)
+static void ixgbe_mta_get(struct ixgbe_adapter *adapter, u16 vector)
 {
-	struct ixgbe_adapter *adapter = netdev_priv(netdev);
-	struct ixgbe_hw *hw = &adapter->hw;
-#ifdef NETDEV_HW_ADDR_T_MULTICAST
-	struct netdev_hw_addr *ha;
-#endif
-	u8  *addr_list = NULL;
-	int addr_count = 0;
+	u32 *mta_shadow = adapter->hw.mac.mta_shadow;
 
-	if (!hw->mac.ops.update_mc_addr_list)
-		return -ENOMEM;
+	vector &= IXGBE_MTA_BITS - 1;
+	if (adapter->mta_refcnt[vector]++)
+		return;
 
-	if (!netif_running(netdev))
-		return 0;
+	mta_shadow[vector >> 5] |= BIT(vector & 0x1F);
+	set_bit(vector >> 5, adapter->mta_dirty);
+	adapter->mta_bits_used++;
+}
 
-#ifdef CONFIG_PCI_IOV
-	ixgbe_restore_vf_multicasts(adapter);
-#endif
+/**
+ * ixgbe_mta_put - drop a reference on a multicast hash bit
+ * @adapter: pointer to private adapter struct
+ * @vector: 12 bit MTA hash
+ *
+ * The bit is cleared once nobody references it.  Called with mta_lock held.
+ **/
+static void ixgbe_mta_put(struct ixgbe_adapter *adapter, u16 vector)
+{
+	u32 *mta_shadow = adapter->hw.mac.mta_shadow;
 
-	if (netdev_mc_empty(netdev)) {
-		hw->mac.ops.update_mc_addr_list(hw, NULL, 0,
-						ixgbe_addr_list_itr, false);
-	} else {
-#ifdef NETDEV_HW_ADDR_T_MULTICAST
+	vector &= IXGBE_MTA_BITS - 1;
+	if (WARN_ON_ONCE(!adapter->mta_refcnt[vector]))
+		return;
+
+	if (--adapter->mta_refcnt[vector])
+		return;
+
+	mta_shadow[vector >> 5] &= ~BIT(vector & 0x1F);
+	set_bit(vector >> 5, adapter->mta_dirty);
+	adapter->mta_bits_used--;
+}
+
+/**
+ * ixgbe_mta_flush - write the MTA registers that changed
+ * @adapter: pointer to private adapter struct
+ *
+ * Called with mta_lock held.
+ **/
+static void ixgbe_mta_flush(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_hw *hw = &adapter->hw;
+	u32 mcstctrl = hw->mac.mc_filter_type;
+	unsigned int i;
+
+	if (bitmap_empty(adapter->mta_dirty, IXGBE_MAX_MTA))
+		return;
+
+	for_each_set_bit(i, adapter->mta_dirty, hw->mac.mcft_size)
+		IXGBE_WRITE_REG_ARRAY(hw, IXGBE_MTA(0), i,
+				      hw->mac.mta_shadow[i]);
+	bitmap_zero(adapter->mta_dirty, IXGBE_MAX_MTA);
+
+	hw->addr_ctrl.mta_in_use = adapter->mta_bits_used;
+	if (adapter->mta_bits_used)
+		mcstctrl |= IXGBE_MCSTCTRL_MFE;
+	IXGBE_WRITE_REG(hw, IXGBE_MCSTCTRL, mcstctrl);
+}
+
+/**
+ * ixgbe_mta_update - replace the multicast hashes of one VF in the MTA
+ * @adapter: pointer to private adapter struct
+ * @old: hashes previously held
+ * @old_count: number of entries in @old
+ * @new: hashes held from now on
+ * @new_count: number of entries in @new
+ *
+ * References on the new hashes are taken before the old ones are dropped
+ * so that a hash kept across the update never leaves the table, and only
+ * the registers whose bits actually changed are written.
+ **/
+void ixgbe_mta_update(struct ixgbe_adapter *adapter, const u16 *old,
+		      u16 old_count, const u16 *new, u16 new_count)
+{
+	u16 i;
+
+	spin_lock_bh(&adapter->mta_lock);
+
+	for (i = 0; i < new_count; i++)
+		ixgbe_mta_get(adapter, new[i]);
+	for (i = 0; i < old_count; i++)
+		ixgbe_mta_put(adapter, old[i]);
+
+	ixgbe_mta_flush(adapter);
+
+	spin_unlock_bh(&adapter->mta_lock);
+}
+
+/**
+ * ixgbe_mta_restore - rewrite the whole MTA from the cache
+ * @adapter: pointer to private adapter struct
+ *
+ * A MAC reset clears the table in hardware while the references survive.
+ **/
+static void ixgbe_mta_restore(struct ixgbe_adapter *adapter)
+{
+	spin_lock_bh(&adapter->mta_lock);
+	bitmap_fill(adapter->mta_dirty, IXGBE_MAX_MTA);
+	ixgbe_mta_flush(adapter);
+	spin_unlock_bh(&adapter->mta_lock);
+}
+
+/**
+ * ixgbe_write_mc_addr_list - write multicast addresses to MTA
+ * @netdev: network interface device structure
+ *
+ * Hashes the PF multicast list and updates the MTA bits the PF references,
+ * leaving the bits held by VFs alone.
+ * Returns: -ENOMEM on failure
+ *                0 on no addresses written
+ *                X on writing X addresses to MTA
+ **/
+int ixgbe_write_mc_addr_list(struct net_device *netdev)
+{
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+	struct ixgbe_hw *hw = &adapter->hw;
+#ifdef NETDEV_HW_ADDR_T_MULTICAST
+	struct netdev_hw_addr *ha;
+#endif
+	u8  *addr_list = NULL;
+	int addr_count = 0;
+	unsigned int bit;
+	u32 vmdq;
+	int i;
+
+	if (!hw->mac.ops.update_mc_addr_list)
+		return -ENOMEM;
+
+	if (!netif_running(netdev))
+		return 0;
+
+#ifdef CONFIG_PCI_IOV
+	/* VF filter state is only lost when the MAC was reset */
+	if (adapter->flags2 & IXGBE_FLAG2_VF_MC_RESTORE) {
+		adapter->flags2 &= ~IXGBE_FLAG2_VF_MC_RESTORE;
+		ixgbe_restore_vf_multicasts(adapter);
+	}
+#endif
+
+	if (!netdev_mc_empty(netdev)) {
+#ifdef NETDEV_HW_ADDR_T_MULTICAST
 		ha = list_first_entry(&netdev->mc.list,
 				      struct netdev_hw_addr, list);
 		addr_list = ha->addr;
@@ -6136,11 +6620,33 @@ int ixgbe_write_mc_addr_list(struct net_device *netdev)
 		addr_list = netdev->mc_list->dmi_addr;
 #endif
 		addr_count = netdev_mc_count(netdev);
+	}
 
-		hw->mac.ops.update_mc_addr_list(hw, addr_list, addr_count,
-						ixgbe_addr_list_itr, false);
+	spin_lock_bh(&adapter->mta_lock);
+
+	/* the PF holds a single reference per hash however many of its
+	 * addresses share it
+	 */
+	bitmap_zero(adapter->pf_mta_new, IXGBE_MTA_BITS);
+	for (i = 0; i < addr_count; i++) {
+		u8 *addr = ixgbe_addr_list_itr(hw, &addr_list, &vmdq);
+
+		__set_bit(ixgbe_mta_vector(hw, addr), adapter->pf_mta_new);
 	}
 
+	for_each_set_bit(bit, adapter->pf_mta_new, IXGBE_MTA_BITS)
+		if (!test_bit(bit, adapter->pf_mta))
+			ixgbe_mta_get(adapter, bit);
+	for_each_set_bit(bit, adapter->pf_mta, IXGBE_MTA_BITS)
+		if (!test_bit(bit, adapter->pf_mta_new))
+			ixgbe_mta_put(adapter, bit);
+	bitmap_copy(adapter->pf_mta, adapter->pf_mta_new, IXGBE_MTA_BITS);
+
+	hw->addr_ctrl.num_mc_addrs = addr_count;
+	ixgbe_mta_flush(adapter);
+
+	spin_unlock_bh(&adapter->mta_lock);
+
 	return addr_count;
 }
 
@@ -6967,6 +7473,36 @@ static void ixgbe_configure_pb(struct ixgbe_adapter *adapter)
 	ixgbe_pbthresh_setup(adapter);
 }
 
+/**
+ * ixgbe_fdir_hits_alloc - Allocate the per-rule Flow Director hit counters
+ * @adapter: board private structure
+ *
+ * Only done once perfect filters are enabled, from the configure path
+ * before the Rx rings run.  The counters then stay until the device is
+ * removed.  Without them only the per-queue match counts are kept.
+ **/
+static void ixgbe_fdir_hits_alloc(struct ixgbe_adapter *adapter)
+{
+	if (adapter->fdir_rule_hits)
+		return;
+
+	adapter->fdir_rule_map = bitmap_zalloc(IXGBE_FDIR_MAX_RULES,
+					       GFP_KERNEL);
+	if (!adapter->fdir_rule_map)
+		goto err;
+
+	adapter->fdir_rule_hits = vzalloc(IXGBE_FDIR_MAX_RULES *
+					  sizeof(atomic64_t));
+	if (!adapter->fdir_rule_hits)
+		goto err;
+
+	return;
+err:
+	bitmap_free(adapter->fdir_rule_map);
+	adapter->fdir_rule_map = NULL;
+	e_warn(drv, "Flow Director hit counters allocation failed\n");
+}
+
 static void ixgbe_fdir_filter_restore(struct ixgbe_adapter *adapter)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
@@ -6982,6 +7518,9 @@ static void ixgbe_fdir_filter_restore(struct ixgbe_adapter *adapter)
 
 	hlist_for_each_entry_safe(filter, node2,
 				  &adapter->fdir_filter_list, fdir_node) {
+		if (adapter->fdir_rule_map)
+			__set_bit(filter->sw_idx, adapter->fdir_rule_map);
+
 		if (filter->action == IXGBE_FDIR_DROP_QUEUE) {
 			queue = IXGBE_FDIR_DROP_QUEUE;
 		} else {
@@ -7138,6 +7677,7 @@ static void ixgbe_configure(struct ixgbe_adapter *adapter)
 	ixgbe_configure_virtualization(adapter);
 
 	ixgbe_set_rx_mode(adapter->netdev);
+	ixgbe_rss_ctx_rule_restore(adapter);
 #if defined(NETIF_F_HW_VLAN_TX) || defined(NETIF_F_HW_VLAN_CTAG_TX)
 	ixgbe_restore_vlan(adapter);
 #endif
@@ -7152,6 +7692,7 @@ static void ixgbe_configure(struct ixgbe_adapter *adapter)
 	} else if (adapter->flags & IXGBE_FLAG_FDIR_PERFECT_CAPABLE) {
 		ixgbe_init_fdir_perfect_82599(&adapter->hw,
 					      adapter->fdir_pballoc, adapter->cloud_mode);
+		ixgbe_fdir_hits_alloc(adapter);
 		ixgbe_fdir_filter_restore(adapter);
 	}
 
@@ -7525,8 +8066,12 @@ static void ixgbe_up_complete(struct ixgbe_adapter *adapter)
 	adapter->flags |= IXGBE_FLAG_NEED_LINK_UPDATE;
 	adapter->link_check_timeout = jiffies;
 	mod_timer(&adapter->service_timer, jiffies);
+	ixgbe_subtasks_start(adapter);
 
 	ixgbe_clear_vf_stats_counters(adapter);
+	if (adapter->num_vfs)
+		schedule_delayed_work(&adapter->vf_stats_task,
+				      msecs_to_jiffies(adapter->vf_stats_interval));
 	/* Set PF Reset Done bit so PF/VF Mail Ops can work */
 	ctrl_ext = IXGBE_READ_REG(hw, IXGBE_CTRL_EXT);
 	ctrl_ext |= IXGBE_CTRL_EXT_PFRSTD;
@@ -8059,6 +8604,9 @@ void ixgbe_reset(struct ixgbe_adapter *adapter)
 	struct ixgbe_hw *hw = &adapter->hw;
 #ifdef HAVE_SET_RX_MODE
 	struct net_device *netdev = adapter->netdev;
+#endif
+#ifdef CONFIG_PCI_IOV
+	unsigned int i;
 #endif
 	int err;
 
@@ -8109,6 +8657,16 @@ void ixgbe_reset(struct ixgbe_adapter *adapter)
 	/* do not flush user set addresses */
 	ixgbe_mac_set_default_filter(adapter);
 
+	/* the MAC reset cleared the MTA and the VF multicast state */
+	ixgbe_mta_restore(adapter);
+	adapter->flags2 |= IXGBE_FLAG2_VF_MC_RESTORE;
+#ifdef CONFIG_PCI_IOV
+
+	/* VF VLAN filters are gone, no VF may skip its replay */
+	for (i = 0; adapter->vfinfo && i < adapter->num_vfs; i++)
+		adapter->vfinfo[i].cfg_gen = 0;
+#endif
+
 	/* update SAN MAC vmdq pool selection */
 	if (hw->mac.san_mac_rar_index)
 		hw->mac.ops.set_vmdq_san_mac(hw, VMDQ_P(0));
@@ -8244,6 +8802,7 @@ static void ixgbe_fdir_filter_exit(struct ixgbe_adapter *adapter)
 {
 	struct hlist_node *node2;
 	struct ixgbe_fdir_filter *filter;
+	struct ixgbe_rss_ctx_rule *rule;
 
 	spin_lock(&adapter->fdir_perfect_lock);
 
@@ -8253,8 +8812,18 @@ static void ixgbe_fdir_filter_exit(struct ixgbe_adapter *adapter)
 		kfree(filter);
 	}
 	adapter->fdir_filter_count = 0;
+	if (adapter->fdir_rule_map)
+		bitmap_zero(adapter->fdir_rule_map, IXGBE_FDIR_MAX_RULES);
 
 	spin_unlock(&adapter->fdir_perfect_lock);
+
+	/* the reset in ixgbe_down() already dropped their MAC filters */
+	hlist_for_each_entry_safe(rule, node2,
+				  &adapter->rss_ctx_rule_list, node) {
+		hlist_del(&rule->node);
+		kfree(rule);
+	}
+	adapter->rss_ctx_rule_count = 0;
 }
 
 void ixgbe_down(struct ixgbe_adapter *adapter)
@@ -8291,6 +8860,8 @@ void ixgbe_down(struct ixgbe_adapter *adapter)
 	adapter->flags &= ~IXGBE_FLAG_NEED_LINK_UPDATE;
 
 	del_timer_sync(&adapter->service_timer);
+	ixgbe_subtasks_stop(adapter);
+	cancel_delayed_work_sync(&adapter->vf_stats_task);
 
 	if (adapter->num_vfs) {
 		/* Clear EITR Select mapping */
@@ -8310,7 +8881,12 @@ void ixgbe_down(struct ixgbe_adapter *adapter)
 #ifdef HAVE_PCI_ERS
 	if (!pci_channel_offline(adapter->pdev))
 #endif
+	{
+		/* the reset clears the counters, keep what they hold */
+		if (!IXGBE_REMOVED(hw->hw_addr))
+			ixgbe_harvest_stats(adapter, true);
 		ixgbe_reset(adapter);
+	}
 
 	/* power down the optics for 82599 SFP+ fiber */
 	if (hw->mac.ops.disable_tx_laser)
@@ -8462,6 +9038,17 @@ static int ixgbe_sw_init(struct ixgbe_adapter *adapter)
 		goto out;
 	}
 
+	if (hw->mac.type >= ixgbe_mac_X550) {
+		adapter->pool_rss = kcalloc(IXGBE_MAX_VMDQ_INDICES,
+					    sizeof(struct ixgbe_pool_rss),
+					    GFP_KERNEL);
+		if (!adapter->pool_rss) {
+			err = IXGBE_ERR_OUT_OF_MEM;
+			e_err(probe, "pool_rss allocation failed: %d\n", err);
+			goto out;
+		}
+	}
+
 	adapter->af_xdp_zc_qps = bitmap_zalloc(IXGBE_MAX_XDP_QS, GFP_KERNEL);
 	if (!adapter->af_xdp_zc_qps)
 		return -ENOMEM;
@@ -8578,6 +9165,8 @@ static int ixgbe_sw_init(struct ixgbe_adapter *adapter)
 	/* n-tuple support exists, always init our spinlock */
 	spin_lock_init(&adapter->fdir_perfect_lock);
 
+	spin_lock_init(&adapter->mta_lock);
+
 #if IS_ENABLED(CONFIG_DCB)
 	switch (hw->mac.type) {
 	case ixgbe_mac_82598EB:
@@ -9416,22 +10005,13 @@ static void ixgbe_get_ring_stats64(struct rtnl_link_stats64 *stats,
 }
 
 /**
- * ixgbe_get_stats64 - Get System Network Statistics
- * @netdev: network interface device structure
- * @stats: storage space for 64bit statistics
- *
- * Returns 64bit statistics, for use in the ndo_get_stats64 callback. This
- * function replaces ixgbe_get_stats for kernels which support it.
- */
-#ifdef HAVE_VOID_NDO_GET_STATS64
-static void ixgbe_get_stats64(struct net_device *netdev,
-			      struct rtnl_link_stats64 *stats)
-#else
-static struct rtnl_link_stats64 *
-ixgbe_get_stats64(struct net_device *netdev, struct rtnl_link_stats64 *stats)
-#endif
+ * ixgbe_sum_ring_stats64 - add up the packet and byte counters of all rings
+ * @adapter: board private structure
+ * @stats: where to add the totals
+ **/
+static void ixgbe_sum_ring_stats64(struct ixgbe_adapter *adapter,
+				   struct rtnl_link_stats64 *stats)
 {
-	struct ixgbe_adapter *adapter = netdev_priv(netdev);
 	int i;
 
 	rcu_read_lock();
@@ -9463,13 +10043,76 @@ ixgbe_get_stats64(struct net_device *netdev, struct rtnl_link_stats64 *stats)
 		ixgbe_get_ring_stats64(stats, ring);
 	}
 	rcu_read_unlock();
+}
+
+/**
+ * ixgbe_refresh_ring_totals - re-sum the ring counters once they are stale
+ * @adapter: board private structure
+ * @max_age: how long the previous sum may be reused, in milliseconds
+ **/
+static void ixgbe_refresh_ring_totals(struct ixgbe_adapter *adapter,
+				      u32 max_age)
+{
+	unsigned long expires = msecs_to_jiffies(max_age);
 
-	/* following stats updated by ixgbe_watchdog_task() */
-	stats->multicast	= netdev->stats.multicast;
-	stats->rx_errors	= netdev->stats.rx_errors;
-	stats->rx_length_errors	= netdev->stats.rx_length_errors;
-	stats->rx_crc_errors	= netdev->stats.rx_crc_errors;
-	stats->rx_missed_errors	= netdev->stats.rx_missed_errors;
+	if (time_before(jiffies, READ_ONCE(adapter->ring_totals_stamp) +
+				 expires))
+		return;
+
+	write_seqlock_bh(&adapter->stats_lock);
+	/* another reader may have summed them while we waited */
+	if (time_after_eq(jiffies, adapter->ring_totals_stamp + expires)) {
+		memset(&adapter->ring_totals, 0, sizeof(adapter->ring_totals));
+		ixgbe_sum_ring_stats64(adapter, &adapter->ring_totals);
+		WRITE_ONCE(adapter->ring_totals_stamp, jiffies);
+	}
+	write_sequnlock_bh(&adapter->stats_lock);
+}
+
+/**
+ * ixgbe_get_stats64 - Get System Network Statistics
+ * @netdev: network interface device structure
+ * @stats: storage space for 64bit statistics
+ *
+ * Returns 64bit statistics, for use in the ndo_get_stats64 callback. This
+ * function replaces ixgbe_get_stats for kernels which support it.
+ *
+ * Walking every ring pulls a cache line from each cleaning CPU, so the
+ * ring totals are summed at most once per ring_totals_max_age and readers
+ * in between share the result.
+ */
+#ifdef HAVE_VOID_NDO_GET_STATS64
+static void ixgbe_get_stats64(struct net_device *netdev,
+			      struct rtnl_link_stats64 *stats)
+#else
+static struct rtnl_link_stats64 *
+ixgbe_get_stats64(struct net_device *netdev, struct rtnl_link_stats64 *stats)
+#endif
+{
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+	u32 max_age = READ_ONCE(adapter->ring_totals_max_age);
+	unsigned int seq;
+
+	if (max_age)
+		ixgbe_refresh_ring_totals(adapter, max_age);
+	else
+		ixgbe_sum_ring_stats64(adapter, stats);
+
+	/* the rest is updated by ixgbe_update_stats() */
+	do {
+		seq = read_seqbegin(&adapter->stats_lock);
+		if (max_age) {
+			stats->rx_packets = adapter->ring_totals.rx_packets;
+			stats->rx_bytes   = adapter->ring_totals.rx_bytes;
+			stats->tx_packets = adapter->ring_totals.tx_packets;
+			stats->tx_bytes   = adapter->ring_totals.tx_bytes;
+		}
+		stats->multicast	= netdev->stats.multicast;
+		stats->rx_errors	= netdev->stats.rx_errors;
+		stats->rx_length_errors	= netdev->stats.rx_length_errors;
+		stats->rx_crc_errors	= netdev->stats.rx_crc_errors;
+		stats->rx_missed_errors	= netdev->stats.rx_missed_errors;
+	} while (read_seqretry(&adapter->stats_lock, seq));
 #ifndef HAVE_VOID_NDO_GET_STATS64
 
 	return stats;
@@ -9481,19 +10124,16 @@ ixgbe_get_stats64(struct net_device *netdev, struct rtnl_link_stats64 *stats)
  * @netdev: network interface device structure
  *
  * Returns the address of the device statistics structure.
- * The statistics are actually updated from the timer callback.
+ * The statistics are actually updated by the stats subtask.
  **/
 static struct net_device_stats *ixgbe_get_stats(struct net_device *netdev)
 {
-	struct ixgbe_adapter *adapter = netdev_priv(netdev);
-
-	/* update the stats data */
-	ixgbe_update_stats(adapter);
-
 #ifdef HAVE_NETDEV_STATS_IN_NETDEV
 	/* only return the current stats */
 	return &netdev->stats;
 #else
+	struct ixgbe_adapter *adapter = netdev_priv(netdev);
+
 	/* only return the current stats */
 	return &adapter->net_stats;
 #endif /* HAVE_NETDEV_STATS_IN_NETDEV */
@@ -9520,10 +10160,46 @@ static int ixgbe_ndo_get_vf_stats(struct net_device *netdev, int vf,
 #endif /* HAVE_VF_STATS */
 
 /**
- * ixgbe_update_stats - Update the board statistics counters.
+ * ixgbe_stats_block_due - check whether a block of counters is to be read
  * @adapter: board private structure
+ * @blk: block of statistics registers
+ * @all: someone reads the statistics, read every block
  **/
-void ixgbe_update_stats(struct ixgbe_adapter *adapter)
+static bool ixgbe_stats_block_due(struct ixgbe_adapter *adapter,
+				  enum ixgbe_stats_block blk, bool all)
+{
+	static const unsigned int max_age[IXGBE_STATS_BLK_NUM] = {
+		[IXGBE_STATS_BLK_SIZE] = IXGBE_STATS_PKTS_MAX_AGE,
+		[IXGBE_STATS_BLK_QUEUE] = IXGBE_STATS_BYTES_MAX_AGE,
+		[IXGBE_STATS_BLK_PFC] = IXGBE_STATS_PKTS_MAX_AGE,
+		[IXGBE_STATS_BLK_MISC] = IXGBE_STATS_PKTS_MAX_AGE,
+	};
+
+	/* 82598 queue byte counters are only 32 bits wide */
+	if (blk == IXGBE_STATS_BLK_QUEUE &&
+	    adapter->hw.mac.type == ixgbe_mac_82598EB)
+		all = true;
+
+	if (!all &&
+	    time_before(jiffies, adapter->stats_blk_read[blk] +
+				 msecs_to_jiffies(max_age[blk])))
+		return false;
+
+	adapter->stats_blk_read[blk] = jiffies;
+	return true;
+}
+
+/**
+ * ixgbe_harvest_stats - read the statistics registers into the snapshot
+ * @adapter: board private structure
+ * @all: read every block of counters, not just those that are due
+ *
+ * The registers feeding the netdev statistics and the Rx XOFF counters,
+ * which Tx hang detection relies on, are read every time. Everything else
+ * is read as ixgbe_stats_block_due() decides. Readers of adapter->stats,
+ * the adapter counters and the netdev statistics retry on stats_lock.
+ **/
+static void ixgbe_harvest_stats(struct ixgbe_adapter *adapter, bool all)
 {
 #ifdef HAVE_NETDEV_STATS_IN_NETDEV
 	struct net_device_stats *net_stats = &adapter->netdev->stats;
@@ -9536,12 +10212,16 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	u32 i, missed_rx = 0, mpc, bprc, lxon, lxoff, xon_off_tot;
 	u64 non_eop_descs = 0, restart_queue = 0, tx_busy = 0;
 	u64 alloc_rx_page_failed = 0, alloc_rx_buff_failed = 0;
-	u64 alloc_rx_page = 0;
+	u64 alloc_rx_page = 0, tstamp_approx = 0;
 	u64 bytes = 0, packets = 0, hw_csum_rx_error = 0;
+	bool blk_size, blk_queue, blk_pfc, blk_misc;
 
-	if (test_bit(__IXGBE_DOWN, adapter->state) ||
-	    test_bit(__IXGBE_RESETTING, adapter->state))
-		return;
+	write_seqlock_bh(&adapter->stats_lock);
+
+	blk_size = ixgbe_stats_block_due(adapter, IXGBE_STATS_BLK_SIZE, all);
+	blk_queue = ixgbe_stats_block_due(adapter, IXGBE_STATS_BLK_QUEUE, all);
+	blk_pfc = ixgbe_stats_block_due(adapter, IXGBE_STATS_BLK_PFC, all);
+	blk_misc = ixgbe_stats_block_due(adapter, IXGBE_STATS_BLK_MISC, all);
 
 	if (adapter->flags2 & IXGBE_FLAG2_RSC_ENABLED) {
 		u64 rsc_count = 0;
@@ -9561,6 +10241,7 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 		alloc_rx_page_failed += rx_ring->rx_stats.alloc_rx_page_failed;
 		alloc_rx_buff_failed += rx_ring->rx_stats.alloc_rx_buff_failed;
 		hw_csum_rx_error += rx_ring->rx_stats.csum_err;
+		tstamp_approx += rx_ring->rx_stats.tstamp_approx;
 		bytes += rx_ring->stats.bytes;
 		packets += rx_ring->stats.packets;
 
@@ -9570,6 +10251,9 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	adapter->alloc_rx_page_failed = alloc_rx_page_failed;
 	adapter->alloc_rx_buff_failed = alloc_rx_buff_failed;
 	adapter->hw_csum_rx_error = hw_csum_rx_error;
+#ifdef HAVE_PTP_1588_CLOCK
+	adapter->rx_hwtstamp_approx = tstamp_approx;
+#endif
 	net_stats->rx_bytes = bytes;
 	net_stats->rx_packets = packets;
 
@@ -9605,13 +10289,17 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 		missed_rx += mpc;
 		hwstats->mpc[i] += mpc;
 		total_mpc += hwstats->mpc[i];
+		if (hw->mac.type == ixgbe_mac_82598EB && blk_queue) {
+			hwstats->qbtc[i] += IXGBE_READ_REG(hw, IXGBE_QBTC(i));
+			hwstats->qbrc[i] += IXGBE_READ_REG(hw, IXGBE_QBRC(i));
+		}
+		if (!blk_pfc)
+			continue;
 		hwstats->pxontxc[i] += IXGBE_READ_REG(hw, IXGBE_PXONTXC(i));
 		hwstats->pxofftxc[i] += IXGBE_READ_REG(hw, IXGBE_PXOFFTXC(i));
 		switch (hw->mac.type) {
 		case ixgbe_mac_82598EB:
 			hwstats->rnbc[i] += IXGBE_READ_REG(hw, IXGBE_RNBC(i));
-			hwstats->qbtc[i] += IXGBE_READ_REG(hw, IXGBE_QBTC(i));
-			hwstats->qbrc[i] += IXGBE_READ_REG(hw, IXGBE_QBRC(i));
 			hwstats->pxonrxc[i] +=
 				IXGBE_READ_REG(hw, IXGBE_PXONRXC(i));
 			break;
@@ -9631,20 +10319,20 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	}
 
 	/*16 register reads */
-	for (i = 0; i < 16; i++) {
+	for (i = 0; blk_queue && i < 16; i++) {
 		hwstats->qptc[i] += IXGBE_READ_REG(hw, IXGBE_QPTC(i));
 		hwstats->qprc[i] += IXGBE_READ_REG(hw, IXGBE_QPRC(i));
-		if ((hw->mac.type == ixgbe_mac_82599EB) ||
-		    (hw->mac.type == ixgbe_mac_X550) ||
-		    (hw->mac.type == ixgbe_mac_X550EM_x) ||
-		    (hw->mac.type == ixgbe_mac_X550EM_a) ||
-		    (hw->mac.type == ixgbe_mac_E610) ||
-		    (hw->mac.type == ixgbe_mac_X540)) {
-			hwstats->qbtc[i] += IXGBE_READ_REG(hw, IXGBE_QBTC_L(i));
-			IXGBE_READ_REG(hw, IXGBE_QBTC_H(i)); /* to clear */
-			hwstats->qbrc[i] += IXGBE_READ_REG(hw, IXGBE_QBRC_L(i));
-			IXGBE_READ_REG(hw, IXGBE_QBRC_H(i)); /* to clear */
-		}
+		if (hw->mac.type == ixgbe_mac_82598EB)
+			continue;
+		/* 36 bit counters, reading the high half clears them */
+		hwstats->qbtc[i] += IXGBE_READ_REG(hw, IXGBE_QBTC_L(i));
+		hwstats->qbtc[i] +=
+			(u64)IXGBE_READ_REG(hw, IXGBE_QBTC_H(i)) << 32;
+		hwstats->qbrc[i] += IXGBE_READ_REG(hw, IXGBE_QBRC_L(i));
+		hwstats->qbrc[i] +=
+			(u64)IXGBE_READ_REG(hw, IXGBE_QBRC_H(i)) << 32;
+		adapter->hw_rx_no_dma_resources +=
+			IXGBE_READ_REG(hw, IXGBE_QPRDC(i));
 	}
 
 	hwstats->gprc += IXGBE_READ_REG(hw, IXGBE_GPRC);
@@ -9656,7 +10344,8 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	/* 82598 hardware only has a 32 bit counter in the high register */
 	switch (hw->mac.type) {
 	case ixgbe_mac_82598EB:
-		hwstats->lxonrxc += IXGBE_READ_REG(hw, IXGBE_LXONRXC);
+		if (blk_misc)
+			hwstats->lxonrxc += IXGBE_READ_REG(hw, IXGBE_LXONRXC);
 		hwstats->gorc += IXGBE_READ_REG(hw, IXGBE_GORCH);
 		hwstats->gotc += IXGBE_READ_REG(hw, IXGBE_GOTCH);
 		hwstats->tor += IXGBE_READ_REG(hw, IXGBE_TORH);
@@ -9668,21 +10357,23 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 		fallthrough;
 	case ixgbe_mac_E610:
 		/* OS2BMC stats are X540 only*/
-		hwstats->o2bgptc += IXGBE_READ_REG(hw, IXGBE_O2BGPTC);
-		hwstats->o2bspc += IXGBE_READ_REG(hw, IXGBE_O2BSPC);
-		hwstats->b2ospc += IXGBE_READ_REG(hw, IXGBE_B2OSPC);
-		hwstats->b2ogprc += IXGBE_READ_REG(hw, IXGBE_B2OGPRC);
+		if (blk_misc) {
+			hwstats->o2bgptc += IXGBE_READ_REG(hw, IXGBE_O2BGPTC);
+			hwstats->o2bspc += IXGBE_READ_REG(hw, IXGBE_O2BSPC);
+			hwstats->b2ospc += IXGBE_READ_REG(hw, IXGBE_B2OSPC);
+			hwstats->b2ogprc += IXGBE_READ_REG(hw, IXGBE_B2OGPRC);
+		}
 		fallthrough;
 	case ixgbe_mac_82599EB:
-		for (i = 0; i < 16; i++)
-			adapter->hw_rx_no_dma_resources +=
-					     IXGBE_READ_REG(hw, IXGBE_QPRDC(i));
+		/* 36 bit counters, reading the high half clears them */
 		hwstats->gorc += IXGBE_READ_REG(hw, IXGBE_GORCL);
-		IXGBE_READ_REG(hw, IXGBE_GORCH); /* to clear */
+		hwstats->gorc += (u64)IXGBE_READ_REG(hw, IXGBE_GORCH) << 32;
 		hwstats->gotc += IXGBE_READ_REG(hw, IXGBE_GOTCL);
-		IXGBE_READ_REG(hw, IXGBE_GOTCH); /* to clear */
+		hwstats->gotc += (u64)IXGBE_READ_REG(hw, IXGBE_GOTCH) << 32;
 		hwstats->tor += IXGBE_READ_REG(hw, IXGBE_TORL);
-		IXGBE_READ_REG(hw, IXGBE_TORH); /* to clear */
+		hwstats->tor += (u64)IXGBE_READ_REG(hw, IXGBE_TORH) << 32;
+		if (!blk_misc)
+			break;
 		hwstats->lxonrxc += IXGBE_READ_REG(hw, IXGBE_LXONRXCNT);
 #ifdef HAVE_TX_MQ
 		hwstats->fdirmatch += IXGBE_READ_REG(hw, IXGBE_FDIRMATCH);
@@ -9722,12 +10413,6 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	if (hw->mac.type == ixgbe_mac_82598EB)
 		hwstats->mprc -= bprc;
 	hwstats->roc += IXGBE_READ_REG(hw, IXGBE_ROC);
-	hwstats->prc64 += IXGBE_READ_REG(hw, IXGBE_PRC64);
-	hwstats->prc127 += IXGBE_READ_REG(hw, IXGBE_PRC127);
-	hwstats->prc255 += IXGBE_READ_REG(hw, IXGBE_PRC255);
-	hwstats->prc511 += IXGBE_READ_REG(hw, IXGBE_PRC511);
-	hwstats->prc1023 += IXGBE_READ_REG(hw, IXGBE_PRC1023);
-	hwstats->prc1522 += IXGBE_READ_REG(hw, IXGBE_PRC1522);
 	hwstats->rlec += IXGBE_READ_REG(hw, IXGBE_RLEC);
 	lxon = IXGBE_READ_REG(hw, IXGBE_LXONTXC);
 	hwstats->lxontxc += lxon;
@@ -9744,17 +10429,25 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	hwstats->gotc -= (xon_off_tot * (ETH_ZLEN + ETH_FCS_LEN));
 	hwstats->ruc += IXGBE_READ_REG(hw, IXGBE_RUC);
 	hwstats->rfc += IXGBE_READ_REG(hw, IXGBE_RFC);
-	hwstats->rjc += IXGBE_READ_REG(hw, IXGBE_RJC);
-	hwstats->tpr += IXGBE_READ_REG(hw, IXGBE_TPR);
 	hwstats->ptc64 += IXGBE_READ_REG(hw, IXGBE_PTC64);
 	hwstats->ptc64 -= xon_off_tot;
-	hwstats->ptc127 += IXGBE_READ_REG(hw, IXGBE_PTC127);
-	hwstats->ptc255 += IXGBE_READ_REG(hw, IXGBE_PTC255);
-	hwstats->ptc511 += IXGBE_READ_REG(hw, IXGBE_PTC511);
-	hwstats->ptc1023 += IXGBE_READ_REG(hw, IXGBE_PTC1023);
-	hwstats->ptc1522 += IXGBE_READ_REG(hw, IXGBE_PTC1522);
-	hwstats->bptc += IXGBE_READ_REG(hw, IXGBE_BPTC);
 	hwstats->illerrc += IXGBE_READ_REG(hw, IXGBE_ILLERRC);
+	if (blk_size) {
+		hwstats->prc64 += IXGBE_READ_REG(hw, IXGBE_PRC64);
+		hwstats->prc127 += IXGBE_READ_REG(hw, IXGBE_PRC127);
+		hwstats->prc255 += IXGBE_READ_REG(hw, IXGBE_PRC255);
+		hwstats->prc511 += IXGBE_READ_REG(hw, IXGBE_PRC511);
+		hwstats->prc1023 += IXGBE_READ_REG(hw, IXGBE_PRC1023);
+		hwstats->prc1522 += IXGBE_READ_REG(hw, IXGBE_PRC1522);
+		hwstats->rjc += IXGBE_READ_REG(hw, IXGBE_RJC);
+		hwstats->tpr += IXGBE_READ_REG(hw, IXGBE_TPR);
+		hwstats->ptc127 += IXGBE_READ_REG(hw, IXGBE_PTC127);
+		hwstats->ptc255 += IXGBE_READ_REG(hw, IXGBE_PTC255);
+		hwstats->ptc511 += IXGBE_READ_REG(hw, IXGBE_PTC511);
+		hwstats->ptc1023 += IXGBE_READ_REG(hw, IXGBE_PTC1023);
+		hwstats->ptc1522 += IXGBE_READ_REG(hw, IXGBE_PTC1522);
+		hwstats->bptc += IXGBE_READ_REG(hw, IXGBE_BPTC);
+	}
 	/* Fill out the OS statistics structure */
 	net_stats->multicast = hwstats->mprc;
 
@@ -9772,33 +10465,167 @@ void ixgbe_update_stats(struct ixgbe_adapter *adapter)
 	net_stats->rx_crc_errors = hwstats->crcerrs;
 	net_stats->rx_missed_errors = total_mpc;
 
-	/* VF Stats Collection - skip while resetting because these
-	 * are not clear on read and otherwise you'll sometimes get
-	 * crazy values.
-	 */
-	if (!test_bit(__IXGBE_RESETTING, adapter->state)) {
-		for (i = 0; i < adapter->num_vfs; i++) {
-			UPDATE_VF_COUNTER_32bit(IXGBE_PVFGPRC(i),	      \
-					adapter->vfinfo[i].last_vfstats.gprc, \
-					adapter->vfinfo[i].vfstats.gprc);
-			UPDATE_VF_COUNTER_32bit(IXGBE_PVFGPTC(i),	      \
-					adapter->vfinfo[i].last_vfstats.gptc, \
-					adapter->vfinfo[i].vfstats.gptc);
-			UPDATE_VF_COUNTER_36bit(IXGBE_PVFGORC_LSB(i),	      \
-					IXGBE_PVFGORC_MSB(i),		      \
-					adapter->vfinfo[i].last_vfstats.gorc, \
-					adapter->vfinfo[i].vfstats.gorc);
-			UPDATE_VF_COUNTER_36bit(IXGBE_PVFGOTC_LSB(i),	      \
-					IXGBE_PVFGOTC_MSB(i),		      \
-					adapter->vfinfo[i].last_vfstats.gotc, \
-					adapter->vfinfo[i].vfstats.gotc);
-			UPDATE_VF_COUNTER_32bit(IXGBE_PVFMPRC(i),	      \
-					adapter->vfinfo[i].last_vfstats.mprc, \
-					adapter->vfinfo[i].vfstats.mprc);
-		}
+	write_sequnlock_bh(&adapter->stats_lock);
+}
+
+/**
+ * ixgbe_update_stats - Update the board statistics counters.
+ * @adapter: board private structure
+ *
+ * Runs as the "stats" subtask. ethtool and the netdev statistics only read
+ * the snapshot it leaves behind.
+ **/
+void ixgbe_update_stats(struct ixgbe_adapter *adapter)
+{
+	bool all;
+
+	if (test_bit(__IXGBE_DOWN, adapter->state) ||
+	    test_bit(__IXGBE_RESETTING, adapter->state))
+		return;
+
+	all = time_before(jiffies, READ_ONCE(adapter->stats_subscribed) +
+				   IXGBE_STATS_SUB_TIMEOUT);
+	ixgbe_harvest_stats(adapter, all);
+}
+
+/**
+ * ixgbe_stats_subscribe - note that someone reads the detailed statistics
+ * @adapter: board private structure
+ *
+ * Keeps every block of counters on the harvest for IXGBE_STATS_SUB_TIMEOUT.
+ * The first reader after a quiet period waits for one harvest so it does
+ * not see counters that were only read for rollover.
+ **/
+void ixgbe_stats_subscribe(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_subtask *st = &adapter->subtasks[IXGBE_SUBTASK_STATS];
+	unsigned long last = READ_ONCE(adapter->stats_subscribed);
+
+	WRITE_ONCE(adapter->stats_subscribed, jiffies);
+	if (time_before(jiffies, last + IXGBE_STATS_SUB_TIMEOUT))
+		return;
+
+	if (test_bit(__IXGBE_DOWN, adapter->state) ||
+	    test_bit(__IXGBE_REMOVING, adapter->state))
+		return;
+
+	mod_delayed_work(system_wq, &st->work, 0);
+	flush_delayed_work(&st->work);
+}
+
+/**
+ * ixgbe_update_vf_counter - Extend a VF statistics register to 64 bits
+ * @cur: value just read from the register
+ * @mask: width of the register
+ * @last: value read on the previous pass
+ * @counter: 64 bit counter to update
+ **/
+static inline void ixgbe_update_vf_counter(u64 cur, u64 mask, u64 *last,
+					   u64 *counter)
+{
+	if (cur < *last)
+		*counter += mask + 1;
+	*last = cur;
+	*counter = (*counter & ~mask) | cur;
+}
+
+/**
+ * ixgbe_update_vf_rate - Sample the per second rates of a VF
+ * @vfinfo: VF to sample
+ * @now: current jiffies
+ **/
+static void ixgbe_update_vf_rate(struct vf_data_storage *vfinfo,
+				 unsigned long now)
+{
+	unsigned long elapsed = now - vfinfo->vfrate_jiffies;
+	u64 *rate = (u64 *)&vfinfo->vfrate;
+	u64 *prev = (u64 *)&vfinfo->prev_vfstats;
+	u64 *stat = (u64 *)&vfinfo->vfstats;
+	u64 *saved = (u64 *)&vfinfo->saved_rst_vfstats;
+	int k;
+
+	for (k = 0; k < sizeof(struct vf_stats) / sizeof(u64); k++) {
+		u64 total = stat[k] + saved[k];
+
+		if (vfinfo->vfrate_jiffies && elapsed)
+			rate[k] = div64_u64((total - prev[k]) * HZ, elapsed);
+		prev[k] = total;
+	}
+	vfinfo->vfrate_jiffies = now;
+}
+
+/**
+ * ixgbe_update_vf_stats - Update the VF statistics counters
+ * @adapter: board private structure
+ *
+ * The counters of each VF are read back to back before they are folded
+ * into the 64 bit totals, keeping the register burst for all VFs short.
+ **/
+static void ixgbe_update_vf_stats(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_hw *hw = &adapter->hw;
+	unsigned long now = jiffies;
+	u32 i;
+
+	for (i = 0; i < adapter->num_vfs; i++) {
+		struct vf_data_storage *vfinfo = &adapter->vfinfo[i];
+		u32 gprc, gptc, gorc_lsb, gorc_msb, gotc_lsb, gotc_msb, mprc;
+
+		gprc = IXGBE_READ_REG(hw, IXGBE_PVFGPRC(i));
+		gptc = IXGBE_READ_REG(hw, IXGBE_PVFGPTC(i));
+		gorc_lsb = IXGBE_READ_REG(hw, IXGBE_PVFGORC_LSB(i));
+		gorc_msb = IXGBE_READ_REG(hw, IXGBE_PVFGORC_MSB(i));
+		gotc_lsb = IXGBE_READ_REG(hw, IXGBE_PVFGOTC_LSB(i));
+		gotc_msb = IXGBE_READ_REG(hw, IXGBE_PVFGOTC_MSB(i));
+		mprc = IXGBE_READ_REG(hw, IXGBE_PVFMPRC(i));
+
+		ixgbe_update_vf_counter(gprc, IXGBE_VF_COUNTER_32BIT,
+					&vfinfo->last_vfstats.gprc,
+					&vfinfo->vfstats.gprc);
+		ixgbe_update_vf_counter(gptc, IXGBE_VF_COUNTER_32BIT,
+					&vfinfo->last_vfstats.gptc,
+					&vfinfo->vfstats.gptc);
+		ixgbe_update_vf_counter(((u64)gorc_msb << 32) | gorc_lsb,
+					IXGBE_VF_COUNTER_36BIT,
+					&vfinfo->last_vfstats.gorc,
+					&vfinfo->vfstats.gorc);
+		ixgbe_update_vf_counter(((u64)gotc_msb << 32) | gotc_lsb,
+					IXGBE_VF_COUNTER_36BIT,
+					&vfinfo->last_vfstats.gotc,
+					&vfinfo->vfstats.gotc);
+		ixgbe_update_vf_counter(mprc, IXGBE_VF_COUNTER_32BIT,
+					&vfinfo->last_vfstats.mprc,
+					&vfinfo->vfstats.mprc);
+
+		ixgbe_update_vf_rate(vfinfo, now);
 	}
 }
 
+/**
+ * ixgbe_vf_stats_task - Periodic VF statistics collection
+ * @work: pointer to the vf_stats_task work struct
+ *
+ * Runs every vf_stats_interval milliseconds while the interface is up
+ * and VFs are enabled, independently of the watchdog. Collection is
+ * skipped while resetting because the counters are not clear on read and
+ * would otherwise produce bogus values.
+ **/
+void ixgbe_vf_stats_task(struct work_struct *work)
+{
+	struct ixgbe_adapter *adapter = container_of(to_delayed_work(work),
+						     struct ixgbe_adapter,
+						     vf_stats_task);
+
+	if (test_bit(__IXGBE_DOWN, adapter->state) || !adapter->num_vfs)
+		return;
+
+	if (!test_bit(__IXGBE_RESETTING, adapter->state))
+		ixgbe_update_vf_stats(adapter);
+
+	schedule_delayed_work(&adapter->vf_stats_task,
+			      msecs_to_jiffies(adapter->vf_stats_interval));
+}
+
 #ifdef HAVE_TX_MQ
 /**
  * ixgbe_fdir_reinit_subtask - worker thread to reinit FDIR filter table
@@ -9891,10 +10718,155 @@ static void ixgbe_check_hang_subtask(struct ixgbe_adapter *adapter)
 }
 
 /**
- * ixgbe_watchdog_update_link - update the link status
+ * ixgbe_rss_rebalance_subtask - move RETA buckets away from hot Rx queues
  * @adapter: pointer to the device adapter structure
- **/
-static void ixgbe_watchdog_update_link(struct ixgbe_adapter *adapter)
+ *
+ * Samples the per-queue Rx packet rates since the previous sample.  The
+ * service task runs anywhere from HZ/10 to 2s apart, so the counts are
+ * scaled by the elapsed time and windows shorter than
+ * IXGBE_RSS_REBAL_MIN_WINDOW are extended into the next run.
+ * When one queue carries well above the average while another sits well
+ * below it, a single redirection table bucket owned by the hot queue is
+ * handed to the coldest queue.  Buckets are taken round robin so that a
+ * bucket which did not carry the heavy flow is not picked again next time,
+ * and no further moves are made for IXGBE_RSS_REBAL_HOLDOFF so the new
+ * distribution can settle before it is measured.
+ */
+static void ixgbe_rss_rebalance_subtask(struct ixgbe_adapter *adapter)
+{
+	u32 reta_entries = ixgbe_rss_indir_tbl_entries(adapter);
+	u16 rss_i = adapter->ring_feature[RING_F_RSS].indices;
+	u64 hot_load = 0, cold_load = U64_MAX, total = 0, avg;
+	int hot = -1, cold = -1;
+	u32 i, idx = 0, owned = 0;
+	unsigned long now = jiffies;
+	unsigned long elapsed;
+	bool moved = false;
+	bool stale;
+	int q;
+
+	if (!(adapter->flags2 & IXGBE_FLAG2_RSS_REBALANCE))
+		return;
+
+	/* If we're down, removing or resetting, just bail */
+	if (test_bit(__IXGBE_DOWN, adapter->state) ||
+	    test_bit(__IXGBE_REMOVING, adapter->state) ||
+	    test_bit(__IXGBE_RESETTING, adapter->state))
+		return;
+
+	/* RETA values only map 1:1 onto Rx rings in plain RSS mode */
+	if ((adapter->flags & IXGBE_FLAG_VMDQ_ENABLED) ||
+	    netdev_get_num_tc(adapter->netdev) > 1)
+		return;
+
+	rss_i = min_t(u16, rss_i, adapter->num_rx_queues);
+	if (rss_i < 2)
+		return;
+
+	elapsed = now - adapter->rss_rebal_last_sample;
+	if (elapsed < IXGBE_RSS_REBAL_MIN_WINDOW)
+		return;
+
+	/* after a pause, e.g. while disabled, only take a new baseline */
+	stale = elapsed > IXGBE_RSS_REBAL_MAX_WINDOW;
+	adapter->rss_rebal_last_sample = now;
+
+	for (q = 0; q < rss_i; q++) {
+		struct ixgbe_ring *ring = adapter->rx_ring[q];
+		u64 packets, delta;
+#ifdef HAVE_NDO_GET_STATS64
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin(&ring->syncp);
+#endif
+			packets = ring->stats.packets;
+#ifdef HAVE_NDO_GET_STATS64
+		} while (u64_stats_fetch_retry(&ring->syncp, start));
+#endif
+
+		/* ring stats restart from zero when rings are reallocated */
+		if (packets >= adapter->rss_rebal_last_pkts[q])
+			delta = packets - adapter->rss_rebal_last_pkts[q];
+		else
+			delta = 0;
+		adapter->rss_rebal_last_pkts[q] = packets;
+
+		if (stale)
+			continue;
+
+		/* packets per second */
+		delta = div_u64(delta * HZ, elapsed);
+
+		total += delta;
+		if (delta > hot_load) {
+			hot_load = delta;
+			hot = q;
+		}
+		if (delta < cold_load) {
+			cold_load = delta;
+			cold = q;
+		}
+	}
+
+	if (stale || time_before(now, adapter->rss_rebal_holdoff))
+		return;
+
+	if (total < IXGBE_RSS_REBAL_MIN_PPS || hot < 0 || cold < 0 ||
+	    hot == cold)
+		return;
+
+	/* hysteresis: hot must exceed 150% and cold be under 75% of average */
+	avg = div_u64(total, rss_i);
+	if (hot_load * 2 <= avg * 3 || cold_load * 4 >= avg * 3)
+		return;
+
+	for (i = 0; i < reta_entries; i++)
+		if (adapter->rss_indir_tbl[i] == hot)
+			owned++;
+
+	/* a single bucket is one hash bin; moving it only moves the hot spot */
+	if (owned < 2) {
+		adapter->rss_rebal_unsplittable++;
+		adapter->rss_rebal_holdoff = now + IXGBE_RSS_REBAL_HOLDOFF;
+		return;
+	}
+
+	/* serialize against ethtool -X rewriting the table */
+	rtnl_lock();
+	if (test_bit(__IXGBE_DOWN, adapter->state) ||
+	    test_bit(__IXGBE_RESETTING, adapter->state)) {
+		rtnl_unlock();
+		return;
+	}
+
+	for (i = 0; i < reta_entries; i++) {
+		idx = (adapter->rss_rebal_cursor + i) % reta_entries;
+		if (adapter->rss_indir_tbl[idx] != hot)
+			continue;
+
+		adapter->rss_indir_tbl[idx] = cold;
+		ixgbe_store_reta_entry(adapter, idx);
+		adapter->rss_rebal_cursor = idx + 1;
+		moved = true;
+		break;
+	}
+	rtnl_unlock();
+
+	if (!moved)
+		return;
+
+	adapter->rss_rebal_moves++;
+	adapter->rss_rebal_holdoff = now + IXGBE_RSS_REBAL_HOLDOFF;
+	e_dbg(drv, "RSS rebalance: RETA[%u] moved from queue %d to queue %d\n",
+	      idx, hot, cold);
+}
+
+/**
+ * ixgbe_watchdog_update_link - update the link status
+ * @adapter: pointer to the device adapter structure
+ **/
+static void ixgbe_watchdog_update_link(struct ixgbe_adapter *adapter)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
 	u32 link_speed = adapter->link_speed;
@@ -10239,10 +11211,40 @@ static void ixgbe_bad_vf_abort(struct ixgbe_adapter *adapter, u32 vf)
 	}
 }
 
+/**
+ * ixgbe_check_vf_status - Check one VF for a received master abort
+ * @adapter: board private structure
+ * @vf: VF index
+ */
+static void ixgbe_check_vf_status(struct ixgbe_adapter *adapter, u32 vf)
+{
+	struct pci_dev *vfdev = adapter->vfinfo[vf].vfdev;
+	u16 status_reg;
+
+	if (!vfdev)
+		return;
+
+	pci_read_config_word(vfdev, PCI_STATUS, &status_reg);
+	if (status_reg == IXGBE_FAILED_READ_CFG_WORD ||
+	    !(status_reg & PCI_STATUS_REC_MASTER_ABORT))
+		return;
+
+	ixgbe_bad_vf_abort(adapter, vf);
+	ixgbe_issue_vf_flr(adapter, vfdev);
+}
+
+/**
+ * ixgbe_check_for_bad_vf - Look for VFs that caused a PCIe error
+ * @adapter: board private structure
+ *
+ * Only runs the sweep while Tx has stalled, which is what a master abort
+ * from a VF causes, so a working system does not pay for the config space
+ * reads.  A stalled one is swept on every tick so the offending VF gets its
+ * FLR without delay.
+ */
 static void ixgbe_check_for_bad_vf(struct ixgbe_adapter *adapter)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
-	struct pci_dev *pdev = adapter->pdev;
 	unsigned int vf;
 	u32 gpc;
 
@@ -10259,23 +11261,31 @@ static void ixgbe_check_for_bad_vf(struct ixgbe_adapter *adapter)
 	 * requesting a full slot reset.
 	 */
 
-	if (!pdev)
+	if (!adapter->pdev || !adapter->vfinfo)
 		return;
 
 	/* check status reg for all VFs owned by this PF */
-	for (vf = 0; vf < adapter->num_vfs; ++vf) {
-		struct pci_dev *vfdev = adapter->vfinfo[vf].vfdev;
-		u16 status_reg;
+	for (vf = 0; vf < adapter->num_vfs; ++vf)
+		ixgbe_check_vf_status(adapter, vf);
+}
 
-		if (!vfdev)
-			continue;
-		pci_read_config_word(vfdev, PCI_STATUS, &status_reg);
-		if (status_reg != IXGBE_FAILED_READ_CFG_WORD &&
-		    status_reg & PCI_STATUS_REC_MASTER_ABORT) {
-			ixgbe_bad_vf_abort(adapter, vf);
-			ixgbe_issue_vf_flr(adapter, vfdev);
-		}
-	}
+/**
+ * ixgbe_mdd_recheck - Rescan for MDD events hidden by mailbox traffic
+ * @adapter: board private structure
+ *
+ * The MDD interrupt shares the mailbox cause, and ixgbe_msg_task() only
+ * scans the MDD status right away when an interrupt carried no VF mailbox
+ * or reset event.  If one did, the scan is owed to the next mailbox
+ * interrupt; raise one in software so it still happens, in the IRQ thread
+ * that owns the VF mailboxes.  ixgbe_msg_task() clears the flag once it
+ * has scanned.
+ */
+static void ixgbe_mdd_recheck(struct ixgbe_adapter *adapter)
+{
+	if (!(adapter->flags2 & IXGBE_FLAG2_MDD_RECHECK))
+		return;
+
+	IXGBE_WRITE_REG(&adapter->hw, IXGBE_EICS, IXGBE_EICS_MAILBOX);
 }
 
 static void ixgbe_spoof_check(struct ixgbe_adapter *adapter)
@@ -10322,8 +11332,8 @@ static void ixgbe_watchdog_subtask(struct ixgbe_adapter *adapter)
 #ifdef CONFIG_PCI_IOV
 	ixgbe_spoof_check(adapter);
 	ixgbe_check_for_bad_vf(adapter);
+	ixgbe_mdd_recheck(adapter);
 #endif /* CONFIG_PCI_IOV */
-	ixgbe_update_stats(adapter);
 
 	ixgbe_watchdog_flush_tx(adapter);
 }
@@ -10455,7 +11465,8 @@ static void ixgbe_service_timer(struct timer_list *t)
 	if (adapter->flags & IXGBE_FLAG_NEED_LINK_UPDATE)
 		next_event_offset = HZ / 10;
 	else
-		next_event_offset = HZ * 2;
+		next_event_offset = msecs_to_jiffies(READ_ONCE(
+			adapter->subtasks[IXGBE_SUBTASK_SERVICE].interval));
 
 	/* Reset the timer */
 	mod_timer(&adapter->service_timer, next_event_offset + jiffies);
@@ -10554,9 +11565,126 @@ static bool ixgbe_check_fw_error(struct ixgbe_adapter *adapter)
 	return false;
 }
 
+#ifdef HAVE_PTP_1588_CLOCK
+static void ixgbe_ptp_subtask(struct ixgbe_adapter *adapter)
+{
+	if (!test_bit(__IXGBE_PTP_RUNNING, adapter->state))
+		return;
+
+	ixgbe_ptp_overflow_check(adapter);
+	if (unlikely(adapter->flags & IXGBE_FLAG_RX_HWTSTAMP_IN_REGISTER))
+		ixgbe_ptp_rx_hang(adapter);
+	ixgbe_ptp_tx_hang(adapter);
+}
+
+#endif /* HAVE_PTP_1588_CLOCK */
+/**
+ * ixgbe_subtask_work - run a periodic subtask and reschedule it
+ * @work: the work member of a struct ixgbe_subtask
+ *
+ * Runs on the system workqueue rather than ixgbe_wq, which is single
+ * threaded and would queue it behind the service task.
+ **/
+static void ixgbe_subtask_work(struct work_struct *work)
+{
+	struct ixgbe_subtask *st = container_of(to_delayed_work(work),
+						struct ixgbe_subtask, work);
+	struct ixgbe_adapter *adapter = st->adapter;
+	u64 start = ktime_get_ns();
+
+	st->fn(adapter);
+	ixgbe_subtask_account(st, start);
+
+	if (test_bit(__IXGBE_DOWN, adapter->state) ||
+	    test_bit(__IXGBE_REMOVING, adapter->state))
+		return;
+
+	schedule_delayed_work(&st->work,
+			      msecs_to_jiffies(READ_ONCE(st->interval)));
+}
+
+/**
+ * ixgbe_subtasks_init - set up the periodic subtasks
+ * @adapter: board private structure
+ **/
+static void ixgbe_subtasks_init(struct ixgbe_adapter *adapter)
+{
+	static const struct {
+		const char *name;
+		void (*fn)(struct ixgbe_adapter *adapter);
+		u32 interval;
+	} subtasks[IXGBE_SUBTASK_NUM] = {
+		[IXGBE_SUBTASK_SERVICE] = { "service", NULL, 2000 },
+		[IXGBE_SUBTASK_HANG] = { "hang", ixgbe_check_hang_subtask,
+					 2000 },
+		[IXGBE_SUBTASK_STATS] = { "stats", ixgbe_update_stats, 1000 },
+#ifdef HAVE_PTP_1588_CLOCK
+		[IXGBE_SUBTASK_PTP] = { "ptp", ixgbe_ptp_subtask, 1000 },
+#endif
+	};
+	int i;
+
+	for (i = 0; i < IXGBE_SUBTASK_NUM; i++) {
+		struct ixgbe_subtask *st = &adapter->subtasks[i];
+
+		st->adapter = adapter;
+		st->name = subtasks[i].name;
+		st->fn = subtasks[i].fn;
+		st->interval = subtasks[i].interval;
+		INIT_DELAYED_WORK(&st->work, ixgbe_subtask_work);
+	}
+
+	seqlock_init(&adapter->stats_lock);
+	adapter->stats_subscribed = jiffies - IXGBE_STATS_SUB_TIMEOUT;
+#ifdef HAVE_NDO_GET_STATS64
+	adapter->ring_totals_max_age = IXGBE_RING_TOTALS_MAX_AGE;
+	adapter->ring_totals_stamp = jiffies -
+		msecs_to_jiffies(IXGBE_RING_TOTALS_MAX_AGE_LIMIT);
+#endif
+	for (i = 0; i < IXGBE_STATS_BLK_NUM; i++)
+		adapter->stats_blk_read[i] = jiffies;
+}
+
+/**
+ * ixgbe_set_subtask_interval - change how often a periodic subtask runs
+ * @adapter: board private structure
+ * @name: subtask name, as listed in the "subtasks" debugfs file
+ * @interval: new interval in milliseconds
+ *
+ * Takes effect from the next run. Events still schedule the service task
+ * early, and it polls faster while waiting for link.
+ **/
+int ixgbe_set_subtask_interval(struct ixgbe_adapter *adapter,
+			       const char *name, u32 interval)
+{
+	int i;
+
+	if (interval < IXGBE_SUBTASK_INTERVAL_MIN ||
+	    interval > IXGBE_SUBTASK_INTERVAL_MAX)
+		return -ERANGE;
+
+	for (i = 0; i < IXGBE_SUBTASK_NUM; i++) {
+		if (strcmp(adapter->subtasks[i].name, name))
+			continue;
+
+		/* the byte counters read on every harvest must not wrap */
+		if (i == IXGBE_SUBTASK_STATS &&
+		    interval > IXGBE_STATS_BYTES_MAX_AGE)
+			return -ERANGE;
+
+		WRITE_ONCE(adapter->subtasks[i].interval, interval);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
 /**
  * ixgbe_service_task - manages and runs subtasks
  * @work: pointer to work_struct containing our data
+ *
+ * Hang detection and the PTP checks run separately, see
+ * ixgbe_subtask_work().
  **/
 static void ixgbe_service_task(struct work_struct *work)
 {
@@ -10564,6 +11692,7 @@ static void ixgbe_service_task(struct work_struct *work)
 						     struct ixgbe_adapter,
 						     service_task);
 	struct ixgbe_hw *hw = &adapter->hw;
+	u64 start = ktime_get_ns();
 
 	if (IXGBE_REMOVED(adapter->hw.hw_addr)) {
 		if (!test_bit(__IXGBE_DOWN, adapter->state)) {
@@ -10610,16 +11739,9 @@ static void ixgbe_service_task(struct work_struct *work)
 #ifdef HAVE_TX_MQ
 	ixgbe_fdir_reinit_subtask(adapter);
 #endif
-	ixgbe_check_hang_subtask(adapter);
-#ifdef HAVE_PTP_1588_CLOCK
-	if (test_bit(__IXGBE_PTP_RUNNING, adapter->state)) {
-		ixgbe_ptp_overflow_check(adapter);
-		if (unlikely(adapter->flags & IXGBE_FLAG_RX_HWTSTAMP_IN_REGISTER))
-			ixgbe_ptp_rx_hang(adapter);
-		ixgbe_ptp_tx_hang(adapter);
-	}
-#endif /* HAVE_PTP_1588_CLOCK */
+	ixgbe_rss_rebalance_subtask(adapter);
 
+	ixgbe_subtask_account(&adapter->subtasks[IXGBE_SUBTASK_SERVICE], start);
 	ixgbe_service_event_complete(adapter);
 }
 
@@ -11023,6 +12145,35 @@ dma_error:
 	return -1;
 }
 
+/**
+ * ixgbe_atr_admit - Decide whether a connectionless packet adds a filter
+ * @ring: Tx ring the packet is sent on
+ *
+ * UDP and SCTP have no SYN to mark the start of a flow, so one packet in
+ * every atr_udp_sample_rate is sampled.  Sampled packets are then limited
+ * to IXGBE_ATR_UDP_ADMIT_RATE filters per second so that a burst of short
+ * lived flows (DNS and the like) cannot churn the hash filter table.
+ */
+static bool ixgbe_atr_admit(struct ixgbe_ring *ring)
+{
+	if (++ring->atr_udp_count < ring->atr_udp_sample_rate)
+		return false;
+
+	ring->atr_udp_count = 0;
+
+	if (time_after(jiffies, ring->atr_udp_window)) {
+		ring->atr_udp_window = jiffies + HZ;
+		ring->atr_udp_admitted = 0;
+	}
+
+	if (ring->atr_udp_admitted >= IXGBE_ATR_UDP_ADMIT_RATE)
+		return false;
+
+	ring->atr_udp_admitted++;
+
+	return true;
+}
+
 static void ixgbe_atr(struct ixgbe_ring *ring,
 		      struct ixgbe_tx_buffer *first)
 {
@@ -11036,8 +12187,11 @@ static void ixgbe_atr(struct ixgbe_ring *ring,
 	} hdr;
 	struct tcphdr *th;
 	struct sk_buff *skb;
+	__be16 sport, dport;
 	unsigned int hlen;
+	int fh_flags = 0;
 	__be16 vlan_id;
+	u8 flow_type;
 	int l4_proto;
 
 	/* if ring doesn't have a interrupt vector, cannot perform ATR */
@@ -11050,7 +12204,7 @@ static void ixgbe_atr(struct ixgbe_ring *ring,
 
 	ring->atr_count++;
 
-	/* currently only IPv4/IPv6 with TCP is supported */
+	/* currently only IPv4/IPv6 is supported */
 	if (first->protocol != htons(ETH_P_IP) &&
 	    first->protocol != htons(ETH_P_IPV6))
 		return;
@@ -11096,41 +12250,73 @@ static void ixgbe_atr(struct ixgbe_ring *ring,
 	if (unlikely(skb_tail_pointer(skb) < hdr.network + 40))
 		return;
 
-	/* Currently only IPv4/IPv6 with TCP is supported */
+	/* Currently only IPv4/IPv6 with TCP, UDP or SCTP is supported */
 	switch (hdr.ipv4->version) {
 	case IPVERSION:
 		/* access ihl as u8 to avoid unaligned access on ia64 */
 		hlen = (hdr.network[0] & 0x0F) << 2;
 		l4_proto = hdr.ipv4->protocol;
+		/* fragments after the first carry no ports, and the first
+		 * alone would install a filter the rest cannot match
+		 */
+		if (ip_is_fragment(hdr.ipv4))
+			return;
 		break;
 	case 6:
 		hlen = hdr.network - skb->data;
-		l4_proto = ipv6_find_hdr(skb, &hlen, IPPROTO_TCP, NULL, NULL);
+		l4_proto = ipv6_find_hdr(skb, &hlen, -1, NULL, &fh_flags);
+		if (l4_proto < 0 || (fh_flags & IP6_FH_F_FRAG))
+			return;
 		hlen -= hdr.network - skb->data;
 		break;
 	default:
 		return;
 	}
 
-	if (l4_proto != IPPROTO_TCP)
-		return;
+	switch (l4_proto) {
+	case IPPROTO_TCP:
+		if (unlikely(skb_tail_pointer(skb) < hdr.network +
+			     hlen + sizeof(struct tcphdr)))
+			return;
 
-	if (unlikely(skb_tail_pointer(skb) < hdr.network +
-		     hlen + sizeof(struct tcphdr)))
-		return;
+		th = (struct tcphdr *)(hdr.network + hlen);
 
-	th = (struct tcphdr *)(hdr.network + hlen);
+		/* skip this packet since the socket is closing */
+		if (th->fin)
+			return;
 
-	/* skip this packet since the socket is closing */
-	if (th->fin)
-		return;
+		/* sample on all syn packets or once every atr sample count */
+		if (!th->syn && (ring->atr_count < ring->atr_sample_rate))
+			return;
 
-	/* sample on all syn packets or once every atr sample count */
-	if (!th->syn && (ring->atr_count < ring->atr_sample_rate))
-		return;
+		/* reset sample count */
+		ring->atr_count = 0;
+
+		sport = th->source;
+		dport = th->dest;
+		flow_type = IXGBE_ATR_L4TYPE_TCP;
+		break;
+	case IPPROTO_UDP:
+	case IPPROTO_SCTP:
+		if (!ring->atr_udp_sample_rate)
+			return;
 
-	/* reset sample count */
-	ring->atr_count = 0;
+		/* UDP and SCTP headers both start with the two ports */
+		if (unlikely(skb_tail_pointer(skb) < hdr.network +
+			     hlen + 2 * sizeof(__be16)))
+			return;
+
+		if (!ixgbe_atr_admit(ring))
+			return;
+
+		sport = ((__be16 *)(hdr.network + hlen))[0];
+		dport = ((__be16 *)(hdr.network + hlen))[1];
+		flow_type = l4_proto == IPPROTO_UDP ? IXGBE_ATR_L4TYPE_UDP :
+						      IXGBE_ATR_L4TYPE_SCTP;
+		break;
+	default:
+		return;
+	}
 
 	vlan_id = htons(first->tx_flags >> IXGBE_TX_FLAGS_VLAN_SHIFT);
 
@@ -11148,18 +12334,19 @@ static void ixgbe_atr(struct ixgbe_ring *ring,
 	 * and write the value to source port portion of compressed dword
 	 */
 	if (first->tx_flags & (IXGBE_TX_FLAGS_SW_VLAN | IXGBE_TX_FLAGS_HW_VLAN))
-		common.port.src ^= th->dest ^ htons(ETH_P_8021Q);
+		common.port.src ^= dport ^ htons(ETH_P_8021Q);
 	else
-		common.port.src ^= th->dest ^ first->protocol;
-	common.port.dst ^= th->source;
+		common.port.src ^= dport ^ first->protocol;
+	common.port.dst ^= sport;
 
 	switch (hdr.ipv4->version) {
 	case IPVERSION:
-		input.formatted.flow_type = IXGBE_ATR_FLOW_TYPE_TCPV4;
+		input.formatted.flow_type = flow_type;
 		common.ip ^= hdr.ipv4->saddr ^ hdr.ipv4->daddr;
 		break;
 	case 6:
-		input.formatted.flow_type = IXGBE_ATR_FLOW_TYPE_TCPV6;
+		input.formatted.flow_type = flow_type |
+					    IXGBE_ATR_L4TYPE_IPV6_MASK;
 		common.ip ^= hdr.ipv6->saddr.s6_addr32[0] ^
 			     hdr.ipv6->saddr.s6_addr32[1] ^
 			     hdr.ipv6->saddr.s6_addr32[2] ^
@@ -11534,24 +12721,28 @@ netdev_tx_t ixgbe_xmit_frame_ring(struct sk_buff *skb,
 #ifdef SKB_SHARED_TX_IS_UNION
 	if (unlikely(skb_tx(skb)->hardware) &&
 	    adapter->ptp_clock) {
-		if (!test_and_set_bit_lock(__IXGBE_PTP_TX_IN_PROGRESS,
-					   adapter->state)) {
+		switch (ixgbe_ptp_tx_request(adapter, skb)) {
+		case IXGBE_PTP_TX_STAMP:
 			skb_tx(skb)->in_progress = 1;
 #else
 	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) &&
 	    adapter->ptp_clock) {
-		if (!test_and_set_bit_lock(__IXGBE_PTP_TX_IN_PROGRESS,
-				   adapter->state)) {
+		switch (ixgbe_ptp_tx_request(adapter, skb)) {
+		case IXGBE_PTP_TX_STAMP:
 			skb_shinfo(skb)->tx_flags |= SKBTX_IN_PROGRESS;
 #endif
 			tx_flags |= IXGBE_TX_FLAGS_TSTAMP;
 
-			/* schedule check for Tx timestamp */
-			adapter->ptp_tx_skb = skb_get(skb);
-			adapter->ptp_tx_start = jiffies;
-			schedule_work(&adapter->ptp_tx_work);
-		} else {
+			/* wait for the Tx timestamp */
+			ixgbe_ptp_tx_start(adapter);
+			break;
+		case IXGBE_PTP_TX_DEFER:
+			/* held until the timestamp slot is free */
+			first->skb = NULL;
+			return NETDEV_TX_OK;
+		default:
 			adapter->tx_hwtstamp_skipped++;
+			break;
 		}
 	}
 
@@ -11656,10 +12847,11 @@ out_drop:
 #ifdef HAVE_PTP_1588_CLOCK
 cleanup_tx_tstamp:
 	if (unlikely(tx_flags & IXGBE_TX_FLAGS_TSTAMP)) {
+		cancel_work_sync(&adapter->ptp_tx_work);
 		dev_kfree_skb_any(adapter->ptp_tx_skb);
 		adapter->ptp_tx_skb = NULL;
-		cancel_work_sync(&adapter->ptp_tx_work);
-		clear_bit_unlock(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state);
+		/* let the work item pass the slot to any waiting skb */
+		schedule_work(&adapter->ptp_tx_work);
 	}
 #endif
 
@@ -12011,7 +13203,10 @@ static int ixgbe_delete_clsu32(struct ixgbe_adapter *adapter,
 	}
 
 	spin_lock(&adapter->fdir_perfect_lock);
-	err = ixgbe_update_ethtool_fdir_entry(adapter, NULL, loc);
+	if (ixgbe_fdir_loc_is_flower(adapter, loc))
+		err = -EBUSY;
+	else
+		err = ixgbe_update_ethtool_fdir_entry(adapter, NULL, loc);
 	spin_unlock(&adapter->fdir_perfect_lock);
 	return err;
 }
@@ -12360,6 +13555,11 @@ static int ixgbe_configure_clsu32(struct ixgbe_adapter *adapter,
 
 	spin_lock(&adapter->fdir_perfect_lock);
 
+	if (ixgbe_fdir_loc_is_flower(adapter, input->sw_idx)) {
+		err = -EBUSY;
+		goto err_out_w_lock;
+	}
+
 	if (hlist_empty(&adapter->fdir_filter_list)) {
 		memcpy(&adapter->fdir_mask, mask, sizeof(*mask));
 		err = ixgbe_fdir_set_input_mask_82599(hw, mask,
@@ -12436,6 +13636,311 @@ static int ixgbe_setup_tc_cls_u32(struct net_device *dev,
 #endif /* HAVE_NDO_SETUP_TC_REMOVE_TC_TO_NETDEV */
 #endif /* HAVE_TC_SETUP_CLSU32 */
 
+#if defined(HAVE_TCF_BLOCK) && defined(HAVE_TC_SETUP_CLSFLOWER) && \
+    defined(HAVE_TC_FLOW_RULE_INFRASTRUCTURE)
+/**
+ * ixgbe_clsflower_parse_match - map a flower match onto a perfect filter
+ * @adapter: board private structure
+ * @rule: the flower rule
+ * @input: filter to fill in
+ * @mask: filter mask to fill in
+ *
+ * Only what the flow director matches exactly is accepted, the same subset
+ * the u32 offload supports: IPv4 addresses plus TCP or UDP ports.
+ **/
+static int ixgbe_clsflower_parse_match(struct ixgbe_adapter *adapter,
+				       struct flow_rule *rule,
+				       struct ixgbe_fdir_filter *input,
+				       union ixgbe_atr_input *mask)
+{
+	u8 flow_type = IXGBE_ATR_FLOW_TYPE_IPV4;
+	struct flow_match_basic basic;
+
+	if (rule->match.dissector->used_keys &
+	    ~(BIT_ULL(FLOW_DISSECTOR_KEY_CONTROL) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_BASIC) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_IPV4_ADDRS) |
+	      BIT_ULL(FLOW_DISSECTOR_KEY_PORTS))) {
+		e_err(drv, "Unsupported keys used in flower match\n");
+		return -EOPNOTSUPP;
+	}
+
+	/* perfect filters cannot tell fragments apart */
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_CONTROL)) {
+		struct flow_match_control control;
+
+		flow_rule_match_control(rule, &control);
+		if (control.mask->flags) {
+			e_err(drv, "Fragment matches are not supported\n");
+			return -EOPNOTSUPP;
+		}
+	}
+
+	if (!flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_BASIC))
+		return -EOPNOTSUPP;
+
+	flow_rule_match_basic(rule, &basic);
+	if (basic.key->n_proto != htons(ETH_P_IP))
+		return -EOPNOTSUPP;
+
+	if (basic.mask->ip_proto) {
+		switch (basic.key->ip_proto) {
+		case IPPROTO_TCP:
+			flow_type = IXGBE_ATR_FLOW_TYPE_TCPV4;
+			break;
+		case IPPROTO_UDP:
+			flow_type = IXGBE_ATR_FLOW_TYPE_UDPV4;
+			break;
+		default:
+			return -EOPNOTSUPP;
+		}
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_IPV4_ADDRS)) {
+		struct flow_match_ipv4_addrs addrs;
+
+		flow_rule_match_ipv4_addrs(rule, &addrs);
+		input->filter.formatted.src_ip[0] = addrs.key->src;
+		mask->formatted.src_ip[0] = addrs.mask->src;
+		input->filter.formatted.dst_ip[0] = addrs.key->dst;
+		mask->formatted.dst_ip[0] = addrs.mask->dst;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_PORTS)) {
+		struct flow_match_ports ports;
+
+		if (flow_type == IXGBE_ATR_FLOW_TYPE_IPV4)
+			return -EOPNOTSUPP;
+
+		flow_rule_match_ports(rule, &ports);
+		input->filter.formatted.src_port = ports.key->src;
+		mask->formatted.src_port = ports.mask->src;
+		input->filter.formatted.dst_port = ports.key->dst;
+		mask->formatted.dst_port = ports.mask->dst;
+	}
+
+	input->filter.formatted.flow_type = flow_type;
+	mask->formatted.flow_type = IXGBE_ATR_L4TYPE_IPV6_MASK |
+				    IXGBE_ATR_L4TYPE_MASK;
+	if (flow_type == IXGBE_ATR_FLOW_TYPE_IPV4)
+		mask->formatted.flow_type &= IXGBE_ATR_L4TYPE_IPV6_MASK;
+
+	return 0;
+}
+
+/**
+ * ixgbe_clsflower_parse_action - map a flower action onto a filter queue
+ * @adapter: board private structure
+ * @rule: the flower rule
+ * @action: ethtool style ring cookie stored with the filter
+ * @queue: absolute queue the filter steers to
+ *
+ * Supports drop and redirect to a VF netdev, which steers into the VF pool.
+ **/
+static int ixgbe_clsflower_parse_action(struct ixgbe_adapter *adapter,
+					struct flow_rule *rule,
+					u64 *action, u8 *queue)
+{
+	const struct flow_action_entry *act;
+	unsigned int vf;
+
+	if (rule->action.num_entries != 1)
+		return -EOPNOTSUPP;
+
+	act = &rule->action.entries[0];
+	switch (act->id) {
+	case FLOW_ACTION_DROP:
+		*action = IXGBE_FDIR_DROP_QUEUE;
+		*queue = IXGBE_FDIR_DROP_QUEUE;
+		return 0;
+	case FLOW_ACTION_REDIRECT:
+		for (vf = 0; vf < adapter->num_vfs; vf++) {
+			struct pci_dev *vfdev = adapter->vfinfo[vf].vfdev;
+
+			if (!vfdev || pci_get_drvdata(vfdev) != act->dev)
+				continue;
+
+			/* same mapping as ethtool rules so restore agrees */
+			*queue = vf * adapter->num_rx_queues_per_pool;
+			*action = (u64)(vf + 1) << ETHTOOL_RX_FLOW_SPEC_RING_VF_OFF;
+			return 0;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return -EOPNOTSUPP;
+}
+
+/**
+ * ixgbe_clsflower_find_loc - pick a free filter location for a flower rule
+ * @adapter: board private structure
+ *
+ * Locations are handed out from the top of the table so that they stay
+ * clear of ethtool and u32 rules, which users number from the bottom.
+ * Locations held by RSS context rules count as taken as well.
+ * Called with fdir_perfect_lock held.
+ **/
+static int ixgbe_clsflower_find_loc(struct ixgbe_adapter *adapter)
+{
+	int max_loc = (1024 << adapter->fdir_pballoc) - 2;
+	struct ixgbe_rss_ctx_rule *ctx_rule;
+	struct ixgbe_fdir_filter *rule;
+	unsigned long *used;
+	int loc;
+
+	used = bitmap_zalloc(max_loc, GFP_ATOMIC);
+	if (!used)
+		return -ENOMEM;
+
+	hlist_for_each_entry(rule, &adapter->fdir_filter_list, fdir_node)
+		if (rule->sw_idx < max_loc)
+			__set_bit(rule->sw_idx, used);
+	hlist_for_each_entry(ctx_rule, &adapter->rss_ctx_rule_list, node)
+		if (ctx_rule->sw_idx < max_loc)
+			__set_bit(ctx_rule->sw_idx, used);
+
+	for (loc = max_loc - 1; loc >= 0; loc--)
+		if (!test_bit(loc, used))
+			break;
+
+	bitmap_free(used);
+
+	return loc < 0 ? -ENOSPC : loc;
+}
+
+/**
+ * ixgbe_clsflower_find_rule - look up the filter installed for a flower rule
+ * @adapter: board private structure
+ * @cookie: tc cookie of the rule
+ *
+ * Called with fdir_perfect_lock held.
+ **/
+static struct ixgbe_fdir_filter *
+ixgbe_clsflower_find_rule(struct ixgbe_adapter *adapter, unsigned long cookie)
+{
+	struct ixgbe_fdir_filter *rule;
+
+	hlist_for_each_entry(rule, &adapter->fdir_filter_list, fdir_node)
+		if (rule->cookie == cookie)
+			return rule;
+
+	return NULL;
+}
+
+static int ixgbe_configure_clsflower(struct ixgbe_adapter *adapter,
+				     struct flow_cls_offload *f)
+{
+	struct flow_rule *rule = flow_cls_offload_flow_rule(f);
+	struct ixgbe_hw *hw = &adapter->hw;
+	struct ixgbe_fdir_filter *input, *old;
+	union ixgbe_atr_input mask;
+	int loc, err;
+	u8 queue;
+
+	input = kzalloc(sizeof(*input), GFP_KERNEL);
+	if (!input)
+		return -ENOMEM;
+	memset(&mask, 0, sizeof(mask));
+
+	err = ixgbe_clsflower_parse_match(adapter, rule, input, &mask);
+	if (err)
+		goto err_out;
+
+	err = ixgbe_clsflower_parse_action(adapter, rule, &input->action,
+					   &queue);
+	if (err)
+		goto err_out;
+
+	input->cookie = f->cookie;
+
+	spin_lock(&adapter->fdir_perfect_lock);
+
+	/* a known cookie replaces its rule in place */
+	old = ixgbe_clsflower_find_rule(adapter, f->cookie);
+	if (old) {
+		loc = old->sw_idx;
+	} else {
+		loc = ixgbe_clsflower_find_loc(adapter);
+		if (loc < 0) {
+			err = loc;
+			goto err_out_w_lock;
+		}
+	}
+	input->sw_idx = loc;
+
+	/* all perfect filters share one mask, like the u32 offload, though
+	 * the last rule may change it on replace
+	 */
+	if (hlist_empty(&adapter->fdir_filter_list) ||
+	    (old && adapter->fdir_filter_count == 1)) {
+		memcpy(&adapter->fdir_mask, &mask, sizeof(mask));
+		err = ixgbe_fdir_set_input_mask_82599(hw, &mask,
+						      adapter->cloud_mode);
+		if (err)
+			goto err_out_w_lock;
+	} else if (memcmp(&adapter->fdir_mask, &mask, sizeof(mask))) {
+		e_err(drv, "Flower rule mask differs from the installed filters\n");
+		err = -EINVAL;
+		goto err_out_w_lock;
+	}
+
+	ixgbe_atr_compute_perfect_hash_82599(&input->filter, &mask);
+
+	/* like ethtool rules, hardware filters only exist while the
+	 * interface is up, ixgbe_fdir_filter_restore() writes them later
+	 */
+	if (netif_running(adapter->netdev)) {
+		err = ixgbe_fdir_write_perfect_filter_82599(hw, &input->filter,
+							    input->sw_idx,
+							    queue,
+							    adapter->cloud_mode);
+		if (err)
+			goto err_out_w_lock;
+	}
+
+	ixgbe_update_ethtool_fdir_entry(adapter, input, input->sw_idx);
+	spin_unlock(&adapter->fdir_perfect_lock);
+
+	return 0;
+err_out_w_lock:
+	spin_unlock(&adapter->fdir_perfect_lock);
+err_out:
+	kfree(input);
+	return err;
+}
+
+static int ixgbe_delete_clsflower(struct ixgbe_adapter *adapter,
+				  struct flow_cls_offload *f)
+{
+	struct ixgbe_fdir_filter *rule;
+	int err = -ENOENT;
+
+	spin_lock(&adapter->fdir_perfect_lock);
+	rule = ixgbe_clsflower_find_rule(adapter, f->cookie);
+	if (rule)
+		err = ixgbe_update_ethtool_fdir_entry(adapter, NULL,
+						      rule->sw_idx);
+	spin_unlock(&adapter->fdir_perfect_lock);
+
+	return err;
+}
+
+static int ixgbe_setup_tc_cls_flower(struct ixgbe_adapter *adapter,
+				     struct flow_cls_offload *f)
+{
+	switch (f->command) {
+	case FLOW_CLS_REPLACE:
+		return ixgbe_configure_clsflower(adapter, f);
+	case FLOW_CLS_DESTROY:
+		return ixgbe_delete_clsflower(adapter, f);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+#endif /* HAVE_TCF_BLOCK && HAVE_TC_SETUP_CLSFLOWER */
 #ifdef HAVE_TCF_BLOCK
 static int ixgbe_setup_tc_block_cb(enum tc_setup_type type, void *type_data,
 				   void *cb_priv)
@@ -12454,6 +13959,10 @@ static int ixgbe_setup_tc_block_cb(enum tc_setup_type type, void *type_data,
 	case TC_SETUP_CLSU32:
 		return ixgbe_setup_tc_cls_u32(adapter, type_data);
 #endif /* HAVE_TC_SETUP_CLSU32 */
+#if defined(HAVE_TC_SETUP_CLSFLOWER) && defined(HAVE_TC_FLOW_RULE_INFRASTRUCTURE)
+	case TC_SETUP_CLSFLOWER:
+		return ixgbe_setup_tc_cls_flower(adapter, type_data);
+#endif /* HAVE_TC_SETUP_CLSFLOWER && HAVE_TC_FLOW_RULE_INFRASTRUCTURE */
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -14365,6 +15874,9 @@ static int ixgbe_probe(struct pci_dev *pdev,
 		goto err_aci_lock;
 	}
 	INIT_WORK(&adapter->service_task, ixgbe_service_task);
+	ixgbe_subtasks_init(adapter);
+	INIT_DELAYED_WORK(&adapter->mbx_task, ixgbe_vf_mbx_task);
+	INIT_DELAYED_WORK(&adapter->vf_stats_task, ixgbe_vf_stats_task);
 	set_bit(__IXGBE_SERVICE_INITED, adapter->state);
 	clear_bit(__IXGBE_SERVICE_SCHED, adapter->state);
 
@@ -14640,6 +16152,9 @@ err_sw_init:
 #endif
 	kfree(adapter->mac_table);
 	kfree(adapter->rss_key);
+	kfree(adapter->pool_rss);
+	vfree(adapter->fdir_rule_hits);
+	bitmap_free(adapter->fdir_rule_map);
 	bitmap_free(adapter->af_xdp_zc_qps);
 	iounmap(adapter->io_addr);
 	if (mac_type == ixgbe_mac_E610)
@@ -14700,6 +16215,7 @@ static void ixgbe_remove(struct pci_dev *pdev)
 #endif /*HAVE_IXGBE_DEBUG_FS */
 	set_bit(__IXGBE_REMOVING, adapter->state);
 	cancel_work_sync(&adapter->service_task);
+	ixgbe_subtasks_stop(adapter);
 
 	if (adapter->hw.mac.type == ixgbe_mac_E610)
 		ixgbe_shutdown_aci(&adapter->hw);
@@ -14764,6 +16280,9 @@ static void ixgbe_remove(struct pci_dev *pdev)
 #endif /* HAVE_TC_SETUP_CLSU32 */
 	kfree(adapter->mac_table);
 	kfree(adapter->rss_key);
+	kfree(adapter->pool_rss);
+	vfree(adapter->fdir_rule_hits);
+	bitmap_free(adapter->fdir_rule_map);
 	bitmap_free(adapter->af_xdp_zc_qps);
 
 	disable_dev = !test_and_set_bit(__IXGBE_DISABLED, adapter->state);
@@ -975,6 +975,76 @@ out:
 
 }
 
+/**
+ * ixgbe_try_write_mbx_pf - Places a message in the mailbox without waiting
+ * @hw: pointer to the HW structure
+ * @msg: The message buffer
+ * @size: Length of buffer
+ * @vf_id: the VF index
+ *
+ * Makes a single attempt to take the mailbox and never polls for the VF's
+ * ACK. The mailbox is reported busy if the VF holds the buffer or still has
+ * an unread request in it, so the caller can retry once that is handled.
+ * The buffer is released as the VF's negotiated mailbox protocol requires,
+ * like ixgbe_write_mbx_pf() and ixgbe_write_mbx_pf_legacy() do.
+ *
+ * returns SUCCESS if the message was posted or IXGBE_ERR_MBX if busy
+ **/
+s32 ixgbe_try_write_mbx_pf(struct ixgbe_hw *hw, u32 *msg, u16 size, u16 vf_id)
+{
+	u32 pf_mailbox;
+	u16 i;
+
+	DEBUGFUNC("ixgbe_try_write_mbx_pf");
+
+	if (size > hw->mbx.size)
+		return IXGBE_ERR_PARAM;
+
+	pf_mailbox = IXGBE_READ_REG(hw, IXGBE_PFMAILBOX(vf_id));
+	if (pf_mailbox & IXGBE_PFMAILBOX_PFU)
+		return IXGBE_ERR_MBX;
+
+	IXGBE_WRITE_REG(hw, IXGBE_PFMAILBOX(vf_id),
+			pf_mailbox | IXGBE_PFMAILBOX_PFU);
+	pf_mailbox = IXGBE_READ_REG(hw, IXGBE_PFMAILBOX(vf_id));
+	if (!(pf_mailbox & IXGBE_PFMAILBOX_PFU))
+		return IXGBE_ERR_MBX;
+
+	/* do not overwrite a VF request that has not been read yet */
+	if (!ixgbe_check_for_msg_pf(hw, vf_id)) {
+		ixgbe_release_mbx_lock_pf(hw, vf_id);
+		return IXGBE_ERR_MBX;
+	}
+
+	/* flush stale acks as we are overwriting the message buffer */
+	ixgbe_clear_ack_pf(hw, vf_id);
+
+	/* copy the caller specified message to the mailbox memory buffer */
+	for (i = 0; i < size; i++)
+		IXGBE_WRITE_REG_ARRAY(hw, IXGBE_PFMBMEM(vf_id), i, msg[i]);
+
+	/* release the buffer the way the negotiated protocol expects */
+	if (hw->mbx.ops[vf_id].write == ixgbe_write_mbx_pf_legacy) {
+		/* Interrupt VF to tell it a message has been sent and release
+		 * buffer
+		 */
+		IXGBE_WRITE_REG(hw, IXGBE_PFMAILBOX(vf_id),
+				IXGBE_PFMAILBOX_STS);
+	} else {
+		/* interrupt VF to tell it a message has been sent */
+		pf_mailbox = IXGBE_READ_REG(hw, IXGBE_PFMAILBOX(vf_id));
+		pf_mailbox |= IXGBE_PFMAILBOX_STS;
+		IXGBE_WRITE_REG(hw, IXGBE_PFMAILBOX(vf_id), pf_mailbox);
+	}
+
+	/* update stats */
+	hw->mbx.stats.msgs_tx++;
+
+	hw->mbx.ops[vf_id].release(hw, vf_id);
+
+	return IXGBE_SUCCESS;
+}
+
 /**
  * ixgbe_read_mbx_pf_legacy - Read a message from the mailbox
  * @hw: pointer to the HW structure
@@ -1003,6 +1073,9 @@ STATIC s32 ixgbe_read_mbx_pf_legacy(struct ixgbe_hw *hw, u32 *msg, u16 size,
 	for (i = 0; i < size; i++)
 		msg[i] = IXGBE_READ_REG_ARRAY(hw, IXGBE_PFMBMEM(vf_id), i);
 
+	/* the request has been consumed, let the PF post into the buffer */
+	ixgbe_clear_msg_pf(hw, vf_id);
+
 	/* Acknowledge the message and release buffer */
 	IXGBE_WRITE_REG(hw, IXGBE_PFMAILBOX(vf_id), IXGBE_PFMAILBOX_ACK);
 
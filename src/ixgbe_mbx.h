@@ -123,6 +123,28 @@ enum ixgbe_pfvf_api_rev {
 #define IXGBE_VF_UPDATE_XCAST_MODE	0x0c
 #define IXGBE_VF_GET_LINK_STATE 0x10 /* get vf link state */
 
+/* requests private to this driver, kept clear of the opcodes and API
+ * versions used upstream; a VF only reaches them after IXGBE_VF_PRIV_CAPS
+ * returned the matching capability bit
+ */
+#define IXGBE_VF_PRIV_CAPS		0x8000 /* agree on private capabilities */
+#define IXGBE_VF_SET_VLAN_BATCH		0x8001 /* VF adds/removes VLANs */
+#define IXGBE_VF_SET_MACVLAN_BATCH	0x8002 /* VF adds unicast filters */
+
+#define IXGBE_VF_PRIV_CAP_BATCH		BIT(0) /* batched VLAN/MACVLAN */
+#define IXGBE_VF_PRIV_CAPS_SUPPORTED	IXGBE_VF_PRIV_CAP_BATCH
+
+/* batch requests carry the entry count in msginfo, entries start at word 1
+ * and the reply returns a bitmap of the entries that failed in word 1
+ */
+#define IXGBE_VF_BATCH_ENTRY_WORD	1
+#define IXGBE_VF_BATCH_RESULT_WORD	1
+#define IXGBE_VF_VLAN_BATCH_MAX		(IXGBE_VFMAILBOX_SIZE - 1)
+#define IXGBE_VF_VLAN_BATCH_ADD		BIT(31)
+#define IXGBE_VF_MACVLAN_BATCH_MAX	\
+	(((IXGBE_VFMAILBOX_SIZE - 1) * 4) / ETH_ALEN)
+#define IXGBE_VF_MACVLAN_BATCH_CLEAR	0x80 /* msginfo: drop filters first */
+
 /* mode choices for IXGBE_VF_UPDATE_XCAST_MODE */
 enum ixgbevf_xcast_modes {
 	IXGBEVF_XCAST_MODE_NONE = 0,
@@ -141,6 +163,16 @@ enum ixgbevf_xcast_modes {
 #define IXGBE_VF_PERMADDR_MSG_LEN	4
 /* word in permanent address message with the current multicast type */
 #define IXGBE_VF_MC_TYPE_WORD		3
+/* word in the reset reply with the generation of the VF's filter state */
+#define IXGBE_VF_CFG_GEN_WORD		4
+#define IXGBE_VF_RESET_MSG_LEN		5
+
+/* IXGBE_VF_RESET msginfo flag: the VF asks to keep its filters and passes
+ * the generation from its previous reset reply in word 1.  The reply
+ * carries the same flag when the filters were kept and nothing needs to be
+ * replayed.
+ */
+#define IXGBE_VF_RESET_WARM		0x01
 
 #define IXGBE_PF_CONTROL_MSG		0x0100 /* PF control message */
 
@@ -163,6 +195,7 @@ enum ixgbevf_xcast_modes {
 s32 ixgbe_read_mbx(struct ixgbe_hw *hw, u32 *msg, u16 size, u16 mbx_id);
 s32 ixgbe_poll_mbx(struct ixgbe_hw *hw, u32 *msg, u16 size, u16 mbx_id);
 s32 ixgbe_write_mbx(struct ixgbe_hw *hw, u32 *msg, u16 size, u16 mbx_id);
+s32 ixgbe_try_write_mbx_pf(struct ixgbe_hw *hw, u32 *msg, u16 size, u16 vf_id);
 s32 ixgbe_check_for_msg(struct ixgbe_hw *hw, u16 mbx_id);
 s32 ixgbe_check_for_ack(struct ixgbe_hw *hw, u16 mbx_id);
 s32 ixgbe_check_for_rst(struct ixgbe_hw *hw, u16 mbx_id);
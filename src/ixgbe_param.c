@@ -164,6 +164,27 @@ IXGBE_PARAM(max_vfs, "Number of Virtual Functions: 0 = disable (default), "
  * the kernel does not support the netdev bridge setting operations.
 */
 IXGBE_PARAM(VEPA, "VEPA Bridge Mode: 0 = VEB (default), 1 = VEPA");
+
+/* VfStatsInterval - VF statistics collection interval
+ *
+ * Valid Range: 100-60000 milliseconds
+ *
+ * Default Value: 1000
+ */
+IXGBE_PARAM(VfStatsInterval, "VF statistics collection interval in ms "
+	    "(100-60000), default 1000");
+
+/* VfRateBurst - VF maximum rate burst size
+ *
+ * Valid Range: 0-1023 KB
+ *  - 0 use the MAC default
+ *
+ * Default Value: 0
+ */
+IXGBE_PARAM(VfRateBurst, "VF Tx rate limiter burst size in KB (0-1023), "
+	    "default 0 = MAC default");
+
+#define IXGBE_MAX_VF_RATE_BURST	1023
 #endif
 
 /* Interrupt Throttle Rate (interrupts/sec)
@@ -270,6 +291,16 @@ IXGBE_PARAM(AtrSampleRate, "Software ATR Tx packet sample rate");
 #define IXGBE_MIN_ATR_SAMPLE_RATE	1
 #define IXGBE_ATR_SAMPLE_RATE_OFF	0
 #define IXGBE_DEFAULT_ATR_SAMPLE_RATE	20
+
+/* Software ATR UDP/SCTP packet sample rate
+ *
+ * Valid Range: 0-255  0 = off, 1-255 = rate of Tx packet inspection
+ *
+ * Default Value: 0
+ */
+IXGBE_PARAM(AtrUdpSampleRate, "Software ATR Tx UDP/SCTP packet sample rate");
+
+#define IXGBE_DEFAULT_ATR_UDP_SAMPLE_RATE	0
 #endif /* HAVE_TX_MQ */
 
 #if IS_ENABLED(CONFIG_FCOE)
@@ -795,6 +826,53 @@ void ixgbe_check_options(struct ixgbe_adapter *adapter)
 				adapter->flags |=
 					IXGBE_FLAG_SRIOV_VEPA_BRIDGE_MODE;
 		}
+#endif
+	}
+	{ /* VF statistics collection interval */
+		static struct ixgbe_option opt = {
+			.type = range_option,
+			.name = "VF statistics interval (ms)",
+			.err  = "using default of "
+				__MODULE_STRING(IXGBE_VF_STATS_INTERVAL_DEF),
+			.def  = IXGBE_VF_STATS_INTERVAL_DEF,
+			.arg  = { .r = { .min = IXGBE_VF_STATS_INTERVAL_MIN,
+					 .max = IXGBE_VF_STATS_INTERVAL_MAX} }
+		};
+
+#ifdef module_param_array
+		if (num_VfStatsInterval > bd) {
+#endif
+			u32 interval = VfStatsInterval[bd];
+
+			ixgbe_validate_option(adapter->netdev, &interval, &opt);
+			adapter->vf_stats_interval = interval;
+#ifdef module_param_array
+		} else {
+			adapter->vf_stats_interval = opt.def;
+		}
+#endif
+	}
+	{ /* VF rate limiter burst size */
+		static struct ixgbe_option opt = {
+			.type = range_option,
+			.name = "VF rate limiter burst size (KB)",
+			.err  = "using the MAC default",
+			.def  = 0,
+			.arg  = { .r = { .min = 0,
+					 .max = IXGBE_MAX_VF_RATE_BURST} }
+		};
+
+#ifdef module_param_array
+		if (num_VfRateBurst > bd) {
+#endif
+			u32 burst = VfRateBurst[bd];
+
+			ixgbe_validate_option(adapter->netdev, &burst, &opt);
+			adapter->vf_rate_burst = burst;
+#ifdef module_param_array
+		} else {
+			adapter->vf_rate_burst = opt.def;
+		}
 #endif
 	}
 #endif /* CONFIG_PCI_IOV */
@@ -1052,6 +1130,35 @@ void ixgbe_check_options(struct ixgbe_adapter *adapter)
 			adapter->atr_sample_rate = opt.def;
 		}
 	}
+	{ /* Flow Director ATR Tx UDP/SCTP sample packet rate */
+		static struct ixgbe_option opt = {
+			.type = range_option,
+			.name = "Software ATR Tx UDP/SCTP packet sample rate",
+			.err = "using default of "
+				__MODULE_STRING(IXGBE_DEFAULT_ATR_UDP_SAMPLE_RATE),
+			.def = IXGBE_DEFAULT_ATR_UDP_SAMPLE_RATE,
+			.arg = {.r = {.min = IXGBE_ATR_SAMPLE_RATE_OFF,
+				      .max = IXGBE_MAX_ATR_SAMPLE_RATE} }
+		};
+		static const char atr_string[] =
+				"ATR Tx UDP/SCTP packet sample rate set to";
+
+		if (adapter->hw.mac.type == ixgbe_mac_82598EB) {
+			adapter->atr_udp_sample_rate = IXGBE_ATR_SAMPLE_RATE_OFF;
+		} else if (num_AtrUdpSampleRate > bd) {
+			adapter->atr_udp_sample_rate = AtrUdpSampleRate[bd];
+
+			if (adapter->atr_udp_sample_rate) {
+				ixgbe_validate_option(adapter->netdev,
+						      &adapter->atr_udp_sample_rate,
+						      &opt);
+				DPRINTK(PROBE, INFO, "%s %d\n", atr_string,
+					adapter->atr_udp_sample_rate);
+			}
+		} else {
+			adapter->atr_udp_sample_rate = opt.def;
+		}
+	}
 #endif /* HAVE_TX_MQ */
 #if IS_ENABLED(CONFIG_FCOE)
 	{
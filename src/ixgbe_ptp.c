@@ -72,6 +72,11 @@
 
 #define IXGBE_OVERFLOW_PERIOD    (HZ * 30)
 #define IXGBE_PTP_TX_TIMEOUT     (HZ)
+#define IXGBE_PTP_TX_QUEUE_LEN   8
+#define IXGBE_PTP_TX_POLL_MIN_NS 10000
+#define IXGBE_PTP_TX_POLL_MAX_NS 1000000
+#define IXGBE_PTP_GETTIMEX_SAMPLES 4
+#define IXGBE_PTP_PEROUT_MIN_NS  100	/* 10 MHz */
 
 /* We use our own definitions instead of NSEC_PER_SEC because we want to mark
  * the value as a ULL to force precision when bit shifting.
@@ -193,7 +198,9 @@ static void ixgbe_ptp_setup_sdp_X540(struct ixgbe_adapter *adapter)
 
 	/* Read the current clock time, and save the cycle counter value */
 	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	ns = timecounter_read(&adapter->hw_tc);
+	write_seqcount_end(&adapter->hw_tc_seq);
 	clock_edge = adapter->hw_tc.cycle_last;
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 
@@ -222,74 +229,57 @@ static void ixgbe_ptp_setup_sdp_X540(struct ixgbe_adapter *adapter)
 }
 
 /**
- * ixgbe_ptp_setup_sdp_X550
+ * ixgbe_ptp_perout_freqout - half period of a periodic output in cycles
  * @adapter: private adapter structure
+ * @period: output period in ns
  *
- * Enable or disable a clock output signal on SDP 0 for X550 hardware.
+ * FREQOUT counts SYSTIME cycles between two toggles of the clock output,
+ * and cycles are not necessarily nanoseconds, see ixgbe_ptp_read_X550().
+ */
+static u64 ixgbe_ptp_perout_freqout(struct ixgbe_adapter *adapter, u64 period)
+{
+	struct cyclecounter *cc = &adapter->hw_cc;
+
+	return div_u64((period >> 1) << cc->shift, cc->mult);
+}
+
+/**
+ * ixgbe_ptp_setup_perout_X550 - program one periodic output channel
+ * @adapter: private adapter structure
+ * @chan: channel, selects Target Time and FREQOUT 0 or 1
+ * @tssdp: TSSDP value being built
+ * @tsauxc: TSAUXC value being built
  *
- * Use the target time feature to align the output signal on the next full
- * second.
+ * The clock output starts at the target time and toggles every half
+ * period from then on. A start time in the past is moved forward by whole
+ * periods to the first edge after now, which keeps the requested phase.
  *
- * This works by using the cycle counter shift and mult values in reverse, and
- * assumes that the values we're shifting will not overflow.
+ * Must be called with tmreg_lock held.
  */
-static void ixgbe_ptp_setup_sdp_X550(struct ixgbe_adapter *adapter)
+static void ixgbe_ptp_setup_perout_X550(struct ixgbe_adapter *adapter,
+					int chan, u32 *tssdp, u32 *tsauxc)
 {
+	struct ixgbe_ptp_perout *perout = &adapter->ptp_perout[chan];
 	struct cyclecounter *cc = &adapter->hw_cc;
 	struct ixgbe_hw *hw = &adapter->hw;
-	u32 esdp, tsauxc, freqout, trgttiml, trgttimh, rem, tssdp;
-	u64 ns = 0, clock_edge = 0;
+	u64 ns, start, clock_edge;
 	struct timespec64 ts;
-	unsigned long flags;
+	u32 freqout;
 
-	/* disable the pin first */
-	IXGBE_WRITE_REG(hw, IXGBE_TSAUXC, 0x0);
-	IXGBE_WRITE_FLUSH(hw);
-
-	if (!(adapter->flags2 & IXGBE_FLAG2_PTP_PPS_ENABLED))
-		return;
-
-	esdp = IXGBE_READ_REG(hw, IXGBE_ESDP);
-
-	/* enable the SDP0 pin as output, and connected to the
-	 * native function for Timesync (ClockOut)
-	 */
-	esdp |= IXGBE_ESDP_SDP0_DIR |
-		IXGBE_ESDP_SDP0_NATIVE;
-
-	/* enable the Clock Out feature on SDP0, and use Target Time 0 to
-	 * enable generation of interrupts on the clock change.
-	 */
-#define IXGBE_TSAUXC_DIS_TS_CLEAR 0x40000000
-	tsauxc = (IXGBE_TSAUXC_EN_CLK | IXGBE_TSAUXC_ST0 |
-		  IXGBE_TSAUXC_EN_TT0 | IXGBE_TSAUXC_SDP0_INT |
-		  IXGBE_TSAUXC_DIS_TS_CLEAR);
-
-	tssdp = (IXGBE_TSSDP_TS_SDP0_EN |
-		 IXGBE_TSSDP_TS_SDP0_CLK0);
-
-	/* Determine the clock time period to use. This assumes that the
-	 * cycle counter shift is small enough to avoid overflowing a 32bit
-	 * value.
-	 */
-	freqout = (NS_PER_HALF_SEC << cc->shift) / cc->mult;
+	freqout = (u32)ixgbe_ptp_perout_freqout(adapter, perout->period);
 
 	/* Read the current clock time, and save the cycle counter value */
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	ns = timecounter_read(&adapter->hw_tc);
+	write_seqcount_end(&adapter->hw_tc_seq);
 	clock_edge = adapter->hw_tc.cycle_last;
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
-
-	/* Figure out how far past the next second we are */
-	div_u64_rem(ns, NS_PER_SEC, &rem);
 
-	/* Figure out how many nanoseconds to add to round the clock edge up
-	 * to the next full second
-	 */
-	rem = (NS_PER_SEC - rem);
+	start = perout->start;
+	if (start <= ns)
+		start += (div64_u64(ns - start, perout->period) + 1) *
+			 perout->period;
 
-	/* Adjust the clock edge to align with the next full second. */
-	clock_edge += div_u64(((u64)rem << cc->shift), cc->mult);
+	clock_edge += div_u64((start - ns) << cc->shift, cc->mult);
 
 	/* X550 hardware stores the time in 32bits of 'billions of cycles' and
 	 * 32bits of 'cycles'. There's no guarantee that cycles represents
@@ -299,18 +289,95 @@ static void ixgbe_ptp_setup_sdp_X550(struct ixgbe_adapter *adapter)
 	 * See ixgbe_ptp_read_X550() for more details.
 	 */
 	ts = ns_to_timespec64(clock_edge);
-	trgttiml = (u32)ts.tv_nsec;
-	trgttimh = (u32)ts.tv_sec;
 
-	IXGBE_WRITE_REG(hw, IXGBE_FREQOUT0, freqout);
-	IXGBE_WRITE_REG(hw, IXGBE_TRGTTIML0, trgttiml);
-	IXGBE_WRITE_REG(hw, IXGBE_TRGTTIMH0, trgttimh);
+	IXGBE_WRITE_REG(hw, IXGBE_FREQOUT(chan), freqout);
+	IXGBE_WRITE_REG(hw, IXGBE_TRGTTIML(chan), (u32)ts.tv_nsec);
+	IXGBE_WRITE_REG(hw, IXGBE_TRGTTIMH(chan), (u32)ts.tv_sec);
+
+	*tssdp |= IXGBE_TSSDP_TS_SDP_EN(perout->pin) |
+		  (IXGBE_TSSDP_TS_SDP_SEL_CLK(chan) <<
+		   IXGBE_TSSDP_TS_SDP_SEL_SHIFT(perout->pin));
+	*tsauxc |= IXGBE_TSAUXC_EN_CLKOUT(chan) | IXGBE_TSAUXC_ST(chan) |
+		   IXGBE_TSAUXC_EN_TT(chan);
+}
+
+/**
+ * ixgbe_ptp_setup_sdp_X550
+ * @adapter: private adapter structure
+ *
+ * Program the SDP functions of X550 hardware from the adapter state: the
+ * periodic outputs (PPS being a 1 second output on channel 0) and the
+ * auxiliary timestamp inputs. SDPs are switched to their native TimeSync
+ * function only while a channel uses them.
+ *
+ * This is called again after the clock is stepped, since the target times
+ * are computed from the current time.
+ */
+static void ixgbe_ptp_setup_sdp_X550(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_hw *hw = &adapter->hw;
+	u32 esdp, tsim, tsauxc = 0, tssdp = 0;
+	u8 sdp_out = 0, sdp_in = 0;
+	unsigned long flags;
+	int i;
+
+	/* disable the pins first */
+	IXGBE_WRITE_REG(hw, IXGBE_TSAUXC, 0x0);
+	IXGBE_WRITE_FLUSH(hw);
+
+	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+
+	for (i = 0; i < IXGBE_PTP_N_PEROUT; i++) {
+		if (!adapter->ptp_perout[i].period)
+			continue;
+
+		ixgbe_ptp_setup_perout_X550(adapter, i, &tssdp, &tsauxc);
+		sdp_out |= BIT(adapter->ptp_perout[i].pin);
+	}
+
+	tsim = IXGBE_READ_REG(hw, IXGBE_TSIM);
+	tsim &= ~(IXGBE_TSIM_AUTT0 | IXGBE_TSIM_AUTT1);
+	for (i = 0; i < IXGBE_PTP_N_EXTTS; i++) {
+		u8 pin = adapter->ptp_extts_pin[i];
+
+		if (!(adapter->ptp_extts_ena & BIT(i)))
+			continue;
+
+		tssdp |= IXGBE_TSSDP_AUX_SDP_EN(i) |
+			 (pin << IXGBE_TSSDP_AUX_SEL_SHIFT(i));
+		tsauxc |= IXGBE_TSAUXC_EN_TS(i);
+		tsim |= IXGBE_TSIM_AUTT(i);
+		sdp_in |= BIT(pin);
+	}
+
+	/* use Target Time 0 to generate interrupts on the PPS clock change */
+	if (adapter->flags2 & IXGBE_FLAG2_PTP_PPS_ENABLED)
+		tsauxc |= IXGBE_TSAUXC_SDP0_INT;
+	if (tsauxc)
+		tsauxc |= IXGBE_TSAUXC_DIS_TS_CLEAR;
+
+	esdp = IXGBE_READ_REG(hw, IXGBE_ESDP);
+	for (i = 0; i < IXGBE_PTP_N_SDP; i++) {
+		if (!((sdp_out | sdp_in | adapter->ptp_sdp_native) & BIT(i)))
+			continue;
+
+		/* pins no longer in use go back to being GPIO inputs */
+		esdp &= ~(IXGBE_ESDP_SDP_DIR(i) | IXGBE_ESDP_SDP_NATIVE(i));
+		if ((sdp_out | sdp_in) & BIT(i))
+			esdp |= IXGBE_ESDP_SDP_NATIVE(i);
+		if (sdp_out & BIT(i))
+			esdp |= IXGBE_ESDP_SDP_DIR(i);
+	}
+	adapter->ptp_sdp_native = sdp_out | sdp_in;
 
 	IXGBE_WRITE_REG(hw, IXGBE_ESDP, esdp);
 	IXGBE_WRITE_REG(hw, IXGBE_TSSDP, tssdp);
+	IXGBE_WRITE_REG(hw, IXGBE_TSIM, tsim);
 	IXGBE_WRITE_REG(hw, IXGBE_TSAUXC, tsauxc);
 
 	IXGBE_WRITE_FLUSH(hw);
+
+	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 }
 
 /**
@@ -382,10 +449,10 @@ static u64 ixgbe_ptp_read_82599(const struct cyclecounter *cc)
  * We need to convert the adapter's RX/TXSTMP registers into a hwtstamp value
  * which can be used by the stack's ptp functions.
  *
- * The lock is used to protect consistency of the cyclecounter and the SYSTIME
- * registers. However, it does not need to protect against the Rx or Tx
- * timestamp registers, as there can't be a new timestamp until the old one is
- * unlatched by reading.
+ * The hw_tc_seq seqcount protects consistency of the cyclecounter without
+ * taking tmreg_lock, since this runs for every timestamped packet. It does
+ * not need to protect against the Rx or Tx timestamp registers, as there
+ * can't be a new timestamp until the old one is unlatched by reading.
  *
  * In addition to the timestamp in hardware, some controllers need a software
  * overflow cyclecounter, and this function takes this into account as well.
@@ -394,8 +461,8 @@ static void ixgbe_ptp_convert_to_hwtstamp(struct ixgbe_adapter *adapter,
 					  struct skb_shared_hwtstamps *hwtstamp,
 					  u64 timestamp)
 {
-	unsigned long flags;
 	struct timespec64 systime;
+	unsigned int seq;
 	u64 ns;
 
 	memset(hwtstamp, 0, sizeof(*hwtstamp));
@@ -428,9 +495,13 @@ static void ixgbe_ptp_convert_to_hwtstamp(struct ixgbe_adapter *adapter,
 		break;
 	}
 
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
-	ns = timecounter_cyc2time(&adapter->hw_tc, timestamp);
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	/* lockless, so Rx cleanup on many queues does not contend on
+	 * tmreg_lock; writers bump hw_tc_seq under it
+	 */
+	do {
+		seq = read_seqcount_begin(&adapter->hw_tc_seq);
+		ns = timecounter_cyc2time(&adapter->hw_tc, timestamp);
+	} while (read_seqcount_retry(&adapter->hw_tc_seq, seq));
 
 	hwtstamp->hwtstamp = ns_to_ktime(ns);
 }
@@ -582,7 +653,9 @@ static int ixgbe_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 	unsigned long flags;
 
 	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	timecounter_adjtime(&adapter->hw_tc, delta);
+	write_seqcount_end(&adapter->hw_tc_seq);
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 
 	if (adapter->ptp_setup_sdp)
@@ -592,25 +665,19 @@ static int ixgbe_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 }
 
 /**
- * ixgbe_ptp_gettimex
- * @ptp: the ptp clock structure
- * @ts: timespec to hold the PHC timestamp
- * @sts: structure to hold the system time before and after reading the PHC
+ * ixgbe_ptp_read_systime - latch and read SYSTIME once
+ * @adapter: the private adapter struct
+ * @sts: structure to hold the system time before and after the latch
  *
- * read the timecounter and return the correct value on ns,
- * after converting it into a struct timespec.
+ * Returns the raw cycle count for the timecounter. Must be called with
+ * tmreg_lock held.
  */
-static int ixgbe_ptp_gettimex(struct ptp_clock_info *ptp,
-			      struct timespec64 *ts,
-			      struct ptp_system_timestamp *sts)
+static u64 ixgbe_ptp_read_systime(struct ixgbe_adapter *adapter,
+				  struct ptp_system_timestamp *sts)
 {
-	struct ixgbe_adapter *adapter =
-		container_of(ptp, struct ixgbe_adapter, ptp_caps);
 	struct ixgbe_hw *hw = &adapter->hw;
-	unsigned long flags;
-	u64 ns, stamp;
-
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	struct timespec64 ts;
+	u64 stamp;
 
 	switch (adapter->hw.mac.type) {
 	case ixgbe_mac_X550:
@@ -626,9 +693,9 @@ static int ixgbe_ptp_gettimex(struct ptp_clock_info *ptp,
 		ptp_read_system_prets(sts);
 		IXGBE_READ_REG(hw, IXGBE_SYSTIMR);
 		ptp_read_system_postts(sts);
-		ts->tv_nsec = IXGBE_READ_REG(hw, IXGBE_SYSTIML);
-		ts->tv_sec = IXGBE_READ_REG(hw, IXGBE_SYSTIMH);
-		stamp = timespec64_to_ns(ts);
+		ts.tv_nsec = IXGBE_READ_REG(hw, IXGBE_SYSTIML);
+		ts.tv_sec = IXGBE_READ_REG(hw, IXGBE_SYSTIMH);
+		stamp = timespec64_to_ns(&ts);
 		break;
 	default:
 		ptp_read_system_prets(sts);
@@ -638,6 +705,60 @@ static int ixgbe_ptp_gettimex(struct ptp_clock_info *ptp,
 		break;
 	}
 
+	return stamp;
+}
+
+/**
+ * ixgbe_ptp_gettimex
+ * @ptp: the ptp clock structure
+ * @ts: timespec to hold the PHC timestamp
+ * @sts: structure to hold the system time before and after reading the PHC
+ *
+ * read the timecounter and return the correct value on ns,
+ * after converting it into a struct timespec.
+ *
+ * When the system time is requested, SYSTIME is latched
+ * IXGBE_PTP_GETTIMEX_SAMPLES times and the read with the narrowest system
+ * time bracket is returned, which filters out reads that were delayed on
+ * the PCIe bus. The width of that bracket is kept for ethtool statistics.
+ */
+static int ixgbe_ptp_gettimex(struct ptp_clock_info *ptp,
+			      struct timespec64 *ts,
+			      struct ptp_system_timestamp *sts)
+{
+	struct ixgbe_adapter *adapter =
+		container_of(ptp, struct ixgbe_adapter, ptp_caps);
+	struct timespec64 pre_ts = {}, post_ts = {};
+	s64 width, best = S64_MAX;
+	unsigned long flags;
+	u64 ns, stamp = 0;
+	int i;
+
+	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+
+	if (!sts) {
+		stamp = ixgbe_ptp_read_systime(adapter, NULL);
+		goto convert;
+	}
+
+	for (i = 0; i < IXGBE_PTP_GETTIMEX_SAMPLES; i++) {
+		u64 sample = ixgbe_ptp_read_systime(adapter, sts);
+
+		width = timespec64_to_ns(&sts->post_ts) -
+			timespec64_to_ns(&sts->pre_ts);
+		if (width >= best)
+			continue;
+
+		best = width;
+		stamp = sample;
+		pre_ts = sts->pre_ts;
+		post_ts = sts->post_ts;
+	}
+	sts->pre_ts = pre_ts;
+	sts->post_ts = post_ts;
+	adapter->ptp_read_bracket_ns = clamp_t(s64, best, 0, U32_MAX);
+
+convert:
 	ns = timecounter_cyc2time(&adapter->hw_tc, stamp);
 
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
@@ -679,7 +800,9 @@ static int ixgbe_ptp_settime(struct ptp_clock_info *ptp,
 
 	/* reset the timecounter */
 	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	timecounter_init(&adapter->hw_tc, &adapter->hw_cc, ns);
+	write_seqcount_end(&adapter->hw_tc_seq);
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 
 	if (adapter->ptp_setup_sdp)
@@ -745,17 +868,289 @@ static int ixgbe_ptp_feature_enable(struct ptp_clock_info *ptp,
 	return 0;
 }
 
+/**
+ * ixgbe_ptp_find_pin - look up the SDP assigned to a function and channel
+ * @adapter: the private adapter structure
+ * @func: PTP_PF_EXTTS or PTP_PF_PEROUT
+ * @chan: channel of @func
+ *
+ * Returns the SDP number, or -1 if no SDP is assigned.
+ */
+static int ixgbe_ptp_find_pin(struct ixgbe_adapter *adapter,
+			      enum ptp_pin_function func, unsigned int chan)
+{
+#ifdef HAVE_PTP_FIND_PIN_UNLOCKED
+	/* the PTP core holds its pin mutex around the enable callback */
+	return ptp_find_pin_unlocked(adapter->ptp_clock, func, chan);
+#else
+	return ptp_find_pin(adapter->ptp_clock, func, chan);
+#endif
+}
+
+/**
+ * ixgbe_ptp_pps_X550 - enable or disable the PPS output
+ * @adapter: the private adapter structure
+ * @on: whether to enable or disable the output
+ *
+ * PPS is a 1 second periodic output aligned on full seconds, using
+ * periodic output channel 0 and the SDP assigned to it (SDP0 by default).
+ */
+static int ixgbe_ptp_pps_X550(struct ixgbe_adapter *adapter, int on)
+{
+	struct ixgbe_ptp_perout *perout = &adapter->ptp_perout[0];
+	int pin;
+
+	if (!on) {
+		if (adapter->flags2 & IXGBE_FLAG2_PTP_PPS_ENABLED)
+			memset(perout, 0, sizeof(*perout));
+		adapter->flags2 &= ~IXGBE_FLAG2_PTP_PPS_ENABLED;
+		return 0;
+	}
+
+	if (perout->period &&
+	    !(adapter->flags2 & IXGBE_FLAG2_PTP_PPS_ENABLED))
+		return -EBUSY;
+
+	pin = ixgbe_ptp_find_pin(adapter, PTP_PF_PEROUT, 0);
+	if (pin < 0)
+		return -EINVAL;
+
+	perout->start = 0;
+	perout->period = NS_PER_SEC;
+	perout->pin = pin;
+	adapter->flags2 |= IXGBE_FLAG2_PTP_PPS_ENABLED;
+
+	return 0;
+}
+
+/**
+ * ixgbe_ptp_perout_X550 - configure a periodic output channel
+ * @adapter: the private adapter structure
+ * @rq: the periodic output request
+ * @on: whether to enable or disable the output
+ *
+ * Any period from IXGBE_PTP_PEROUT_MIN_NS up to what FREQOUT can hold
+ * (about 8.5 seconds) is accepted, with a 50% duty cycle.
+ */
+static int ixgbe_ptp_perout_X550(struct ixgbe_adapter *adapter,
+				 struct ptp_perout_request *rq, int on)
+{
+	struct ixgbe_ptp_perout *perout;
+	u64 period, freqout;
+	int pin;
+
+	if (rq->index >= IXGBE_PTP_N_PEROUT)
+		return -EINVAL;
+
+	/* With PTP_PEROUT_PHASE the start field holds the phase instead,
+	 * which is a start time in the past as far as we're concerned, see
+	 * ixgbe_ptp_setup_perout_X550().
+	 */
+	if (rq->flags & ~PTP_PEROUT_PHASE)
+		return -EOPNOTSUPP;
+
+	perout = &adapter->ptp_perout[rq->index];
+	if (!on) {
+		memset(perout, 0, sizeof(*perout));
+		if (!rq->index)
+			adapter->flags2 &= ~IXGBE_FLAG2_PTP_PPS_ENABLED;
+		return 0;
+	}
+
+	if (!rq->index && (adapter->flags2 & IXGBE_FLAG2_PTP_PPS_ENABLED))
+		return -EBUSY;
+
+	pin = ixgbe_ptp_find_pin(adapter, PTP_PF_PEROUT, rq->index);
+	if (pin < 0)
+		return -EINVAL;
+
+	period = rq->period.sec * NS_PER_SEC + rq->period.nsec;
+	freqout = ixgbe_ptp_perout_freqout(adapter, period);
+	if (period < IXGBE_PTP_PEROUT_MIN_NS || !freqout || freqout > U32_MAX)
+		return -ERANGE;
+
+	perout->start = rq->start.sec * NS_PER_SEC + rq->start.nsec;
+	perout->period = period;
+	perout->pin = pin;
+
+	return 0;
+}
+
+/**
+ * ixgbe_ptp_extts_X550 - configure an external timestamp channel
+ * @adapter: the private adapter structure
+ * @rq: the external timestamp request
+ * @on: whether to enable or disable the channel
+ *
+ * AUXSTMP0/1 latch SYSTIME on both edges of their SDP, so a request
+ * strictly asking for a single edge is refused.
+ */
+static int ixgbe_ptp_extts_X550(struct ixgbe_adapter *adapter,
+				struct ptp_extts_request *rq, int on)
+{
+	u32 edges = PTP_RISING_EDGE | PTP_FALLING_EDGE;
+	int pin;
+
+	if (rq->index >= IXGBE_PTP_N_EXTTS)
+		return -EINVAL;
+
+	if (rq->flags & ~(PTP_ENABLE_FEATURE | edges | PTP_STRICT_FLAGS))
+		return -EOPNOTSUPP;
+
+	if (!on) {
+		adapter->ptp_extts_ena &= ~BIT(rq->index);
+		return 0;
+	}
+
+	if ((rq->flags & PTP_STRICT_FLAGS) && (rq->flags & edges) != edges)
+		return -EOPNOTSUPP;
+
+	pin = ixgbe_ptp_find_pin(adapter, PTP_PF_EXTTS, rq->index);
+	if (pin < 0)
+		return -EINVAL;
+
+	adapter->ptp_extts_pin[rq->index] = pin;
+	adapter->ptp_extts_ena |= BIT(rq->index);
+
+	return 0;
+}
+
+/**
+ * ixgbe_ptp_feature_enable_X550
+ * @ptp: the ptp clock structure
+ * @rq: the requested feature to change
+ * @on: whether to enable or disable the feature
+ *
+ * Enable (or disable) PPS, periodic outputs and external timestamps on
+ * X550 and later. The SDP used by each channel is set through the PTP pin
+ * configuration, see ixgbe_ptp_verify_pin().
+ */
+static int ixgbe_ptp_feature_enable_X550(struct ptp_clock_info *ptp,
+					 struct ptp_clock_request *rq, int on)
+{
+	struct ixgbe_adapter *adapter =
+		container_of(ptp, struct ixgbe_adapter, ptp_caps);
+	int err;
+
+	switch (rq->type) {
+	case PTP_CLK_REQ_PPS:
+		err = ixgbe_ptp_pps_X550(adapter, on);
+		break;
+	case PTP_CLK_REQ_PEROUT:
+		err = ixgbe_ptp_perout_X550(adapter, &rq->perout, on);
+		break;
+	case PTP_CLK_REQ_EXTTS:
+		err = ixgbe_ptp_extts_X550(adapter, &rq->extts, on);
+		break;
+	default:
+		return -ENOTSUPP;
+	}
+
+	if (err)
+		return err;
+
+	adapter->ptp_setup_sdp(adapter);
+	return 0;
+}
+
+/**
+ * ixgbe_ptp_verify_pin - check a pin function assignment
+ * @ptp: the ptp clock structure
+ * @pin: SDP number
+ * @func: requested function
+ * @chan: channel of @func, already checked by the PTP core
+ *
+ * Each of SDP0-3 can carry either periodic output or either auxiliary
+ * timestamp input.
+ */
+static int ixgbe_ptp_verify_pin(struct ptp_clock_info *ptp, unsigned int pin,
+				enum ptp_pin_function func, unsigned int chan)
+{
+	switch (func) {
+	case PTP_PF_NONE:
+	case PTP_PF_EXTTS:
+	case PTP_PF_PEROUT:
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * ixgbe_ptp_init_pins_X550 - set up the default SDP assignment
+ * @adapter: the private adapter structure
+ *
+ * SDP0 keeps carrying periodic output 0, and thus PPS, as it always has.
+ * The other SDPs may be wired to something else on a given board, so they
+ * are left unassigned.
+ */
+static void ixgbe_ptp_init_pins_X550(struct ixgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < IXGBE_PTP_N_SDP; i++) {
+		struct ptp_pin_desc *pin = &adapter->ptp_pins[i];
+
+		snprintf(pin->name, sizeof(pin->name), "SDP%d", i);
+		pin->index = i;
+		pin->func = PTP_PF_NONE;
+		pin->chan = 0;
+	}
+
+	adapter->ptp_pins[0].func = PTP_PF_PEROUT;
+}
+
+/**
+ * ixgbe_ptp_extts_event - report latched auxiliary timestamps
+ * @adapter: the private adapter structure
+ * @tsicr: TimeSync interrupt causes read by the caller
+ *
+ * Called from the TimeSync interrupt on X550 and later. Reading AUXSTMPH
+ * unlocks the latch for the next edge.
+ */
+static void ixgbe_ptp_extts_event(struct ixgbe_adapter *adapter, u32 tsicr)
+{
+	struct skb_shared_hwtstamps shhwtstamps;
+	struct ixgbe_hw *hw = &adapter->hw;
+	struct ptp_clock_event event;
+	u64 stamp;
+	int i;
+
+	if (!adapter->ptp_extts_ena)
+		return;
+
+	for (i = 0; i < IXGBE_PTP_N_EXTTS; i++) {
+		if (!(tsicr & IXGBE_TSICR_AUTT(i)) ||
+		    !(adapter->ptp_extts_ena & BIT(i)))
+			continue;
+
+		stamp = (u64)IXGBE_READ_REG(hw, IXGBE_AUXSTMPL(i));
+		stamp |= (u64)IXGBE_READ_REG(hw, IXGBE_AUXSTMPH(i)) << 32;
+		ixgbe_ptp_convert_to_hwtstamp(adapter, &shhwtstamps, stamp);
+
+		event.type = PTP_CLOCK_EXTTS;
+		event.index = i;
+		event.timestamp = ktime_to_ns(shhwtstamps.hwtstamp);
+		ptp_clock_event(adapter->ptp_clock, &event);
+	}
+}
+
+static void ixgbe_ptp_tx_irq(struct ixgbe_adapter *adapter, u32 tsicr);
+
 /**
  * ixgbe_ptp_check_pps_event
  * @adapter: the private adapter structure
  *
  * This function is called by the interrupt routine when checking for
- * interrupts. It will check and handle a pps event.
+ * interrupts. It will check and handle a pps event, and on X550 and later
+ * the external and Tx timestamp events. TSICR is clear on read there, so
+ * it is read exactly once and every cause is served from that value.
  */
 void ixgbe_ptp_check_pps_event(struct ixgbe_adapter *adapter)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
 	struct ptp_clock_event event;
+	u32 tsicr;
 
 	event.type = PTP_CLOCK_PPS;
 
@@ -770,6 +1165,14 @@ void ixgbe_ptp_check_pps_event(struct ixgbe_adapter *adapter)
 	case ixgbe_mac_X540:
 		ptp_clock_event(adapter->ptp_clock, &event);
 		break;
+	case ixgbe_mac_X550:
+	case ixgbe_mac_X550EM_x:
+	case ixgbe_mac_X550EM_a:
+	case ixgbe_mac_E610:
+		tsicr = IXGBE_READ_REG(hw, IXGBE_TSICR);
+		ixgbe_ptp_extts_event(adapter, tsicr);
+		ixgbe_ptp_tx_irq(adapter, tsicr);
+		break;
 	default:
 		break;
 	}
@@ -794,7 +1197,9 @@ void ixgbe_ptp_overflow_check(struct ixgbe_adapter *adapter)
 	if (timeout) {
 		/* Update the timecounter */
 		spin_lock_irqsave(&adapter->tmreg_lock, flags);
+		write_seqcount_begin(&adapter->hw_tc_seq);
 		timecounter_read(&adapter->hw_tc);
+		write_seqcount_end(&adapter->hw_tc_seq);
 		spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 
 		adapter->last_overflow_check = jiffies;
@@ -845,50 +1250,93 @@ void ixgbe_ptp_rx_hang(struct ixgbe_adapter *adapter)
 }
 
 /**
- * ixgbe_ptp_clear_tx_timestamp - utility function to clear Tx timestamp state
+ * ixgbe_ptp_tx_next - hand the Tx timestamp slot to the next waiting skb
  * @adapter: the private adapter structure
  *
- * This function should be called whenever the state related to a Tx timestamp
- * needs to be cleared. This helps ensure that all related bits are reset for
- * the next Tx timestamp event.
+ * The hardware latches a single Tx timestamp, so only one packet may carry
+ * the timestamp request at a time.  Packets that asked for one while the
+ * slot was busy were held back by ixgbe_ptp_tx_request(); the oldest of
+ * them is given the slot and ixgbe_ptp_tx_resend_work() posts it, and the
+ * slot is released only once none are left waiting.
  */
-static void ixgbe_ptp_clear_tx_timestamp(struct ixgbe_adapter *adapter)
+static void ixgbe_ptp_tx_next(struct ixgbe_adapter *adapter)
 {
-	struct ixgbe_hw *hw = &adapter->hw;
+	struct sk_buff *skb, *stale;
+	unsigned long flags;
 
-	IXGBE_READ_REG(hw, IXGBE_TXSTMPH);
-	if (adapter->ptp_tx_skb) {
-		dev_kfree_skb_any(adapter->ptp_tx_skb);
+	spin_lock_irqsave(&adapter->ptp_tx_queue.lock, flags);
+	skb = __skb_dequeue(&adapter->ptp_tx_queue);
+	/* a packet whose slot expired before it was posted is dropped */
+	stale = adapter->ptp_tx_resend;
+	adapter->ptp_tx_resend = skb;
+	if (skb) {
+		adapter->ptp_tx_skb = skb_get(skb);
+		adapter->ptp_tx_start = jiffies;
+	} else {
 		adapter->ptp_tx_skb = NULL;
+		clear_bit_unlock(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state);
 	}
-	clear_bit_unlock(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state);
+	spin_unlock_irqrestore(&adapter->ptp_tx_queue.lock, flags);
+
+	if (stale)
+		dev_kfree_skb_any(stale);
+	if (skb)
+		schedule_work(&adapter->ptp_tx_resend_work);
 }
 
 /**
- * ixgbe_ptp_tx_hang - detect error case where Tx timestamp never finishes
- * @adapter: private network adapter structure
+ * ixgbe_ptp_tx_request - claim the Tx timestamp slot for an skb
+ * @adapter: the private adapter structure
+ * @skb: packet asking for a hardware Tx timestamp
+ *
+ * Called from the transmit path.  If the slot is busy the skb is queued,
+ * up to IXGBE_PTP_TX_QUEUE_LEN of them, and the caller must drop its
+ * reference to it without sending; it is posted on its ring again once
+ * ixgbe_ptp_tx_next() gives it the slot.
  */
-void ixgbe_ptp_tx_hang(struct ixgbe_adapter *adapter)
+enum ixgbe_ptp_tx_req ixgbe_ptp_tx_request(struct ixgbe_adapter *adapter,
+					   struct sk_buff *skb)
 {
-	bool timeout = time_is_before_jiffies(adapter->ptp_tx_start +
-					      IXGBE_PTP_TX_TIMEOUT);
+	enum ixgbe_ptp_tx_req ret = IXGBE_PTP_TX_STAMP;
+	unsigned long flags;
 
-	if (!adapter->ptp_tx_skb)
-		return;
+	spin_lock_irqsave(&adapter->ptp_tx_queue.lock, flags);
+	if (skb == adapter->ptp_tx_skb) {
+		/* posted by ixgbe_ptp_tx_resend_work(), already owns the slot */
+	} else if (!test_and_set_bit_lock(__IXGBE_PTP_TX_IN_PROGRESS,
+					  adapter->state)) {
+		adapter->ptp_tx_skb = skb_get(skb);
+		adapter->ptp_tx_start = jiffies;
+	} else if (test_bit(__IXGBE_PTP_RUNNING, adapter->state) &&
+		   skb_queue_len(&adapter->ptp_tx_queue) <
+		   IXGBE_PTP_TX_QUEUE_LEN) {
+		__skb_queue_tail(&adapter->ptp_tx_queue, skb);
+		adapter->tx_hwtstamp_deferred++;
+		ret = IXGBE_PTP_TX_DEFER;
+	} else {
+		ret = IXGBE_PTP_TX_SKIP;
+	}
+	spin_unlock_irqrestore(&adapter->ptp_tx_queue.lock, flags);
 
-	if (!test_bit(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state))
-		return;
+	return ret;
+}
 
-	/* If we haven't received a timestamp within the timeout, it is
-	 * reasonable to assume that it will never occur, so we can unlock the
-	 * timestamp bit when this occurs.
-	 */
-	if (timeout) {
-		cancel_work_sync(&adapter->ptp_tx_work);
-		ixgbe_ptp_clear_tx_timestamp(adapter);
-		adapter->tx_hwtstamp_timeouts++;
-		e_warn(drv, "clearing Tx timestamp hang\n");
-	}
+/**
+ * ixgbe_ptp_clear_tx_timestamp - utility function to clear Tx timestamp state
+ * @adapter: the private adapter structure
+ *
+ * This function should be called whenever the state related to a Tx timestamp
+ * needs to be cleared. This helps ensure that all related bits are reset for
+ * the next Tx timestamp event.
+ */
+static void ixgbe_ptp_clear_tx_timestamp(struct ixgbe_adapter *adapter)
+{
+	struct ixgbe_hw *hw = &adapter->hw;
+
+	IXGBE_READ_REG(hw, IXGBE_TXSTMPH);
+	if (adapter->ptp_tx_skb)
+		dev_kfree_skb_any(adapter->ptp_tx_skb);
+	ixgbe_ptp_tx_next(adapter);
 }
 
 /**
@@ -910,26 +1358,66 @@ static void ixgbe_ptp_tx_hwtstamp(struct ixgbe_adapter *adapter)
 	regval |= (u64)IXGBE_READ_REG(hw, IXGBE_TXSTMPH) << 32;
 	ixgbe_ptp_convert_to_hwtstamp(adapter, &shhwtstamps, regval);
 
-	/* Handle cleanup of the ptp_tx_skb ourselves, and unlock the state
-	 * bit prior to notifying the stack via skb_tstamp_tx(). This prevents
+	/* Handle cleanup of the ptp_tx_skb ourselves, and pass on the slot
+	 * prior to notifying the stack via skb_tstamp_tx(). This prevents
 	 * well behaved applications from attempting to timestamp again prior
 	 * to the lock bit being clear.
 	 */
-	adapter->ptp_tx_skb = NULL;
-	clear_bit_unlock(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state);
+	ixgbe_ptp_tx_next(adapter);
 
 	/* Notify the stack and then free the skb after we've unlocked */
 	skb_tstamp_tx(skb, &shhwtstamps);
 	dev_kfree_skb_any(skb);
 }
 
+/**
+ * ixgbe_ptp_tx_hang - detect error case where Tx timestamp never finishes
+ * @adapter: private network adapter structure
+ */
+void ixgbe_ptp_tx_hang(struct ixgbe_adapter *adapter)
+{
+	bool timeout = time_is_before_jiffies(adapter->ptp_tx_start +
+					      IXGBE_PTP_TX_TIMEOUT);
+
+	if (!adapter->ptp_tx_skb)
+		return;
+
+	if (!test_bit(__IXGBE_PTP_TX_IN_PROGRESS, adapter->state))
+		return;
+
+	/* If we haven't received a timestamp within the timeout, it is
+	 * reasonable to assume that it will never occur, so we can unlock the
+	 * timestamp bit when this occurs.
+	 */
+	if (timeout) {
+		cancel_work_sync(&adapter->ptp_tx_work);
+
+		/* the work item may have passed the slot on meanwhile */
+		if (!adapter->ptp_tx_skb ||
+		    time_is_after_eq_jiffies(adapter->ptp_tx_start +
+					     IXGBE_PTP_TX_TIMEOUT))
+			return;
+
+		/* the interrupt may have been missed, use a late stamp */
+		if (IXGBE_READ_REG(&adapter->hw, IXGBE_TSYNCTXCTL) &
+		    IXGBE_TSYNCTXCTL_VALID) {
+			ixgbe_ptp_tx_hwtstamp(adapter);
+			return;
+		}
+		ixgbe_ptp_clear_tx_timestamp(adapter);
+		adapter->tx_hwtstamp_timeouts++;
+		e_warn(drv, "clearing Tx timestamp hang\n");
+	}
+}
+
 /**
  * ixgbe_ptp_tx_hwtstamp_work
  * @work: pointer to the work struct
  *
- * This work item polls TSYNCTXCTL valid bit to determine when a Tx hardware
- * timestamp has been taken for the current skb. It is necessary, because the
- * descriptor's "done" bit does not correlate with the timestamp event.
+ * This work item completes the pending Tx timestamp once TSYNCTXCTL shows
+ * it valid. It is queued by the TimeSync interrupt or by the poll timer,
+ * and is necessary because the descriptor's "done" bit does not correlate
+ * with the timestamp event.
  */
 static void ixgbe_ptp_tx_hwtstamp_work(struct work_struct *work)
 {
@@ -946,7 +1434,6 @@ static void ixgbe_ptp_tx_hwtstamp_work(struct work_struct *work)
 		return;
 	}
 
-	/* stop polling once we have a valid timestamp */
 	tsynctxctl = IXGBE_READ_REG(hw, IXGBE_TSYNCTXCTL);
 	if (tsynctxctl & IXGBE_TSYNCTXCTL_VALID) {
 		ixgbe_ptp_tx_hwtstamp(adapter);
@@ -958,12 +1445,154 @@ static void ixgbe_ptp_tx_hwtstamp_work(struct work_struct *work)
 		ixgbe_ptp_clear_tx_timestamp(adapter);
 		adapter->tx_hwtstamp_timeouts++;
 		e_warn(drv, "clearing Tx Timestamp hang\n");
-	} else {
-		/* reschedule to keep checking if it's not available yet */
-		schedule_work(&adapter->ptp_tx_work);
 	}
 }
 
+/**
+ * ixgbe_ptp_tx_resend_work - post a deferred skb that now owns the slot
+ * @work: pointer to the work struct
+ *
+ * The stack already counted the packet as sent when it was deferred, so it
+ * goes straight onto its Tx ring under the queue lock.  Passing it through
+ * dev_queue_xmit() again would run the qdisc, tc actions and packet taps
+ * twice.  If the ring cannot take it, the packet is dropped and the slot
+ * passes on at once rather than at the timestamp timeout.
+ */
+static void ixgbe_ptp_tx_resend_work(struct work_struct *work)
+{
+	struct ixgbe_adapter *adapter = container_of(work, struct ixgbe_adapter,
+						     ptp_tx_resend_work);
+	netdev_tx_t ret = NETDEV_TX_BUSY;
+	struct ixgbe_ring *tx_ring;
+	struct netdev_queue *txq;
+	unsigned int r_idx = 0;
+	struct sk_buff *skb;
+	unsigned long flags;
+	bool ready;
+
+	spin_lock_irqsave(&adapter->ptp_tx_queue.lock, flags);
+	skb = adapter->ptp_tx_resend;
+	adapter->ptp_tx_resend = NULL;
+	spin_unlock_irqrestore(&adapter->ptp_tx_queue.lock, flags);
+
+	if (!skb)
+		return;
+
+#ifdef HAVE_TX_MQ
+	r_idx = skb->queue_mapping % adapter->num_tx_queues;
+#endif
+	tx_ring = adapter->tx_ring[r_idx];
+	txq = txring_txq(tx_ring);
+
+	__netif_tx_lock_bh(txq);
+	ready = !test_bit(__IXGBE_DOWN, adapter->state) &&
+		netif_carrier_ok(adapter->netdev);
+#ifdef HAVE_AF_XDP_ZC_SUPPORT
+	ready &= !test_bit(__IXGBE_TX_DISABLED, &tx_ring->state);
+#endif
+	if (ready)
+		ret = ixgbe_xmit_frame_ring(skb, adapter, tx_ring);
+	__netif_tx_unlock_bh(txq);
+
+	if (ret == NETDEV_TX_OK)
+		return;
+
+	cancel_work_sync(&adapter->ptp_tx_work);
+	if (adapter->ptp_tx_skb == skb)
+		ixgbe_ptp_clear_tx_timestamp(adapter);
+	dev_kfree_skb_any(skb);
+}
+
+/**
+ * ixgbe_ptp_tx_irq_capable - check for the Tx timestamp interrupt
+ * @adapter: the private adapter struct
+ *
+ * X550 and later raise the TimeSync interrupt when a Tx timestamp is
+ * latched, see ixgbe_ptp_start_cyclecounter(). Older MACs have to poll.
+ */
+static bool ixgbe_ptp_tx_irq_capable(struct ixgbe_adapter *adapter)
+{
+	switch (adapter->hw.mac.type) {
+	case ixgbe_mac_X550:
+	case ixgbe_mac_X550EM_x:
+	case ixgbe_mac_X550EM_a:
+	case ixgbe_mac_E610:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * ixgbe_ptp_tx_poll - timer callback polling for a Tx timestamp
+ * @timer: the ptp_tx_timer of the adapter
+ *
+ * Used on MACs without a Tx timestamp interrupt. The poll interval starts
+ * at IXGBE_PTP_TX_POLL_MIN_NS and doubles up to IXGBE_PTP_TX_POLL_MAX_NS,
+ * so a timestamp is normally picked up within microseconds while a lost
+ * one costs little until IXGBE_PTP_TX_TIMEOUT expires. MACs with the
+ * interrupt only poll at IXGBE_PTP_TX_POLL_MAX_NS, as a fallback should
+ * the interrupt be missed.
+ */
+static enum hrtimer_restart ixgbe_ptp_tx_poll(struct hrtimer *timer)
+{
+	struct ixgbe_adapter *adapter = container_of(timer,
+						     struct ixgbe_adapter,
+						     ptp_tx_timer);
+	u32 tsynctxctl;
+
+	if (!adapter->ptp_tx_skb)
+		return HRTIMER_NORESTART;
+
+	tsynctxctl = IXGBE_READ_REG(&adapter->hw, IXGBE_TSYNCTXCTL);
+	if ((tsynctxctl & IXGBE_TSYNCTXCTL_VALID) ||
+	    time_is_before_jiffies(adapter->ptp_tx_start +
+				   IXGBE_PTP_TX_TIMEOUT)) {
+		queue_work(system_highpri_wq, &adapter->ptp_tx_work);
+		return HRTIMER_NORESTART;
+	}
+
+	adapter->ptp_tx_poll_ns = min_t(u32, adapter->ptp_tx_poll_ns * 2,
+					IXGBE_PTP_TX_POLL_MAX_NS);
+	hrtimer_forward_now(timer, ns_to_ktime(adapter->ptp_tx_poll_ns));
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * ixgbe_ptp_tx_start - wait for the Tx timestamp of a sent packet
+ * @adapter: the private adapter struct
+ *
+ * Called from the transmit path after a packet was queued with the
+ * timestamp request bit set.
+ */
+void ixgbe_ptp_tx_start(struct ixgbe_adapter *adapter)
+{
+	/* the TimeSync interrupt normally queues the work first */
+	if (ixgbe_ptp_tx_irq_capable(adapter))
+		adapter->ptp_tx_poll_ns = IXGBE_PTP_TX_POLL_MAX_NS;
+	else
+		adapter->ptp_tx_poll_ns = IXGBE_PTP_TX_POLL_MIN_NS;
+
+	hrtimer_start(&adapter->ptp_tx_timer,
+		      ns_to_ktime(adapter->ptp_tx_poll_ns), HRTIMER_MODE_REL);
+}
+
+/**
+ * ixgbe_ptp_tx_irq - handle the Tx timestamp cause of the TimeSync interrupt
+ * @adapter: the private adapter struct
+ * @tsicr: TimeSync interrupt causes read by the caller
+ *
+ * Called in hard interrupt context on X550 and later.
+ */
+static void ixgbe_ptp_tx_irq(struct ixgbe_adapter *adapter, u32 tsicr)
+{
+	if (!(tsicr & IXGBE_TSICR_TXTS) || !adapter->ptp_tx_skb)
+		return;
+
+	queue_work(system_highpri_wq, &adapter->ptp_tx_work);
+}
+
 /**
  * ixgbe_ptp_rx_pktstamp - utility function to get RX time stamp from buffer
  * @q_vector: structure containing interrupt and ring information
@@ -993,6 +1622,58 @@ void ixgbe_ptp_rx_pktstamp(struct ixgbe_q_vector *q_vector,
 				      le64_to_cpu(regval));
 }
 
+/**
+ * ixgbe_ptp_read_ns - read SYSTIME as nanoseconds of the PHC
+ * @adapter: the private adapter struct
+ */
+static u64 ixgbe_ptp_read_ns(struct ixgbe_adapter *adapter)
+{
+	unsigned long flags;
+	u64 ns;
+
+	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
+	ns = timecounter_read(&adapter->hw_tc);
+	write_seqcount_end(&adapter->hw_tc_seq);
+	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+
+	return ns;
+}
+
+/**
+ * ixgbe_ptp_rx_approx_err - account the error of an approximate stamp
+ * @q_vector: vector the packet was received on
+ * @skb: packet holding a latched Rx timestamp
+ *
+ * Compares the latched stamp with the one ixgbe_ptp_rx_approx() would have
+ * given the packet, and tracks the worst and average difference.
+ */
+static void ixgbe_ptp_rx_approx_err(struct ixgbe_q_vector *q_vector,
+				    struct sk_buff *skb)
+{
+	struct ixgbe_adapter *adapter = q_vector->adapter;
+	unsigned long flags;
+	s64 err;
+
+	if (!q_vector->rx_tstamp_ns)
+		q_vector->rx_tstamp_ns = ixgbe_ptp_read_ns(adapter);
+
+	/* a negative error means the latch belonged to another packet */
+	err = q_vector->rx_tstamp_ns - ktime_to_ns(skb_hwtstamps(skb)->hwtstamp);
+	if (err < 0)
+		return;
+
+	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	if (err > adapter->rx_hwtstamp_approx_err_max)
+		adapter->rx_hwtstamp_approx_err_max = min_t(s64, err, U32_MAX);
+	adapter->rx_hwtstamp_approx_err_sum += err;
+	adapter->rx_hwtstamp_approx_err_cnt++;
+	adapter->rx_hwtstamp_approx_err_avg =
+		div_u64(adapter->rx_hwtstamp_approx_err_sum,
+			adapter->rx_hwtstamp_approx_err_cnt);
+	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+}
+
 /**
  * ixgbe_ptp_rx_rgtstamp - utility function which checks for RX time stamp
  * @q_vector: structure containing interrupt and ring information
@@ -1028,6 +1709,32 @@ void ixgbe_ptp_rx_rgtstamp(struct ixgbe_q_vector *q_vector,
 	regval |= (u64)IXGBE_READ_REG(hw, IXGBE_RXSTMPH) << 32;
 
 	ixgbe_ptp_convert_to_hwtstamp(adapter, skb_hwtstamps(skb), regval);
+
+	if (adapter->flags2 & IXGBE_FLAG2_RX_TSTAMP_APPROX_ON)
+		ixgbe_ptp_rx_approx_err(q_vector, skb);
+}
+
+/**
+ * ixgbe_ptp_rx_approx - give a packet the approximate time it was received
+ * @rx_ring: ring the packet was received on
+ * @skb: packet the hardware did not timestamp
+ *
+ * 82599 and X540 can only latch the receive time of PTP event packets. In
+ * the approximate "timestamp all" mode every other packet is stamped with
+ * SYSTIME as read once per NAPI poll. All the packets of a poll arrived
+ * before that read, so the stamp is late by at most the interrupt delay
+ * plus the length of the poll; ixgbe_ptp_rx_approx_err() measures how
+ * late on the PTP packets that do carry a latched stamp.
+ */
+void ixgbe_ptp_rx_approx(struct ixgbe_ring *rx_ring, struct sk_buff *skb)
+{
+	struct ixgbe_q_vector *q_vector = rx_ring->q_vector;
+
+	if (!q_vector->rx_tstamp_ns)
+		q_vector->rx_tstamp_ns = ixgbe_ptp_read_ns(q_vector->adapter);
+
+	skb_hwtstamps(skb)->hwtstamp = ns_to_ktime(q_vector->rx_tstamp_ns);
+	rx_ring->rx_stats.tstamp_approx++;
 }
 
 /**
@@ -1095,6 +1802,8 @@ static int ixgbe_ptp_set_timestamp_mode(struct ixgbe_adapter *adapter,
 		return -ERANGE;
 	}
 
+	adapter->flags2 &= ~IXGBE_FLAG2_RX_TSTAMP_APPROX_ON;
+
 	switch (config->rx_filter) {
 	case HWTSTAMP_FILTER_NONE:
 		tsync_rx_ctl = 0;
@@ -1143,6 +1852,25 @@ static int ixgbe_ptp_set_timestamp_mode(struct ixgbe_adapter *adapter,
 			adapter->flags |= IXGBE_FLAG_RX_HWTSTAMP_ENABLED;
 			break;
 		}
+		/* Older MACs only latch PTP event packets. If the user opted
+		 * in, keep latching V2 events and give every other packet the
+		 * approximate time of its NAPI poll, see ixgbe_ptp_rx_approx().
+		 */
+		if (hw->mac.type != ixgbe_mac_82598EB &&
+		    adapter->flags2 & IXGBE_FLAG2_RX_TSTAMP_APPROX) {
+			tsync_rx_ctl |= IXGBE_TSYNCRXCTL_TYPE_EVENT_V2;
+			is_l2 = true;
+			config->rx_filter = HWTSTAMP_FILTER_ALL;
+			adapter->flags |= (IXGBE_FLAG_RX_HWTSTAMP_ENABLED |
+					   IXGBE_FLAG_RX_HWTSTAMP_IN_REGISTER);
+			adapter->flags2 |= IXGBE_FLAG2_RX_TSTAMP_APPROX_ON;
+			adapter->rx_hwtstamp_approx_err_sum = 0;
+			adapter->rx_hwtstamp_approx_err_cnt = 0;
+			adapter->rx_hwtstamp_approx_err_max = 0;
+			adapter->rx_hwtstamp_approx_err_avg = 0;
+			e_warn(drv, "Rx timestamps of non-PTP packets are approximate\n");
+			break;
+		}
 		fallthrough;
 	default:
 		/* register RXMTRL must be set in order to do V1 packets,
@@ -1306,6 +2034,8 @@ void ixgbe_ptp_start_cyclecounter(struct ixgbe_adapter *adapter)
 	u32 incval = 0;
 	u32 tsauxc = 0;
 	u32 fuse0 = 0;
+	u32 tsim;
+	int i;
 
 	/* For some of the boards below this mask is technically incorrect.
 	 * The timestamp mask overflows at approximately 61bits. However the
@@ -1349,7 +2079,14 @@ void ixgbe_ptp_start_cyclecounter(struct ixgbe_adapter *adapter)
 		tsauxc = IXGBE_READ_REG(hw, IXGBE_TSAUXC);
 		IXGBE_WRITE_REG(hw, IXGBE_TSAUXC,
 				tsauxc & ~IXGBE_TSAUXC_DISABLE_SYSTIME);
-		IXGBE_WRITE_REG(hw, IXGBE_TSIM, IXGBE_TSIM_TXTS);
+		/* this runs on every link change, keep the enabled external
+		 * timestamp channels armed
+		 */
+		tsim = IXGBE_TSIM_TXTS;
+		for (i = 0; i < IXGBE_PTP_N_EXTTS; i++)
+			if (adapter->ptp_extts_ena & BIT(i))
+				tsim |= IXGBE_TSIM_AUTT(i);
+		IXGBE_WRITE_REG(hw, IXGBE_TSIM, tsim);
 		IXGBE_WRITE_REG(hw, IXGBE_EIMS, IXGBE_EIMS_TIMESYNC);
 
 		IXGBE_WRITE_FLUSH(hw);
@@ -1380,7 +2117,9 @@ void ixgbe_ptp_start_cyclecounter(struct ixgbe_adapter *adapter)
 
 	/* need lock to prevent incorrect read while modifying cyclecounter */
 	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	memcpy(&adapter->hw_cc, &cc, sizeof(adapter->hw_cc));
+	write_seqcount_end(&adapter->hw_tc_seq);
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 }
 
@@ -1411,8 +2150,10 @@ void ixgbe_ptp_reset(struct ixgbe_adapter *adapter)
 	ixgbe_ptp_start_cyclecounter(adapter);
 
 	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	write_seqcount_begin(&adapter->hw_tc_seq);
 	timecounter_init(&adapter->hw_tc, &adapter->hw_cc,
 			 ktime_get_real_ns());
+	write_seqcount_end(&adapter->hw_tc_seq);
 	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
 
 	adapter->last_overflow_check = jiffies;
@@ -1512,9 +2253,19 @@ static long ixgbe_ptp_create_clock(struct ixgbe_adapter *adapter)
 		adapter->ptp_caps.owner = THIS_MODULE;
 		adapter->ptp_caps.max_adj = 30000000;
 		adapter->ptp_caps.n_alarm = 0;
-		adapter->ptp_caps.n_ext_ts = 0;
-		adapter->ptp_caps.n_per_out = 0;
+		adapter->ptp_caps.n_ext_ts = IXGBE_PTP_N_EXTTS;
+		adapter->ptp_caps.n_per_out = IXGBE_PTP_N_PEROUT;
+		adapter->ptp_caps.n_pins = IXGBE_PTP_N_SDP;
 		adapter->ptp_caps.pps = 1;
+		adapter->ptp_caps.pin_config = adapter->ptp_pins;
+		adapter->ptp_caps.verify = ixgbe_ptp_verify_pin;
+#ifdef HAVE_PTP_CLOCK_INFO_SUPPORTED_FLAGS
+		adapter->ptp_caps.supported_extts_flags = PTP_RISING_EDGE |
+							  PTP_FALLING_EDGE |
+							  PTP_STRICT_FLAGS;
+		adapter->ptp_caps.supported_perout_flags = PTP_PEROUT_PHASE;
+#endif
+		ixgbe_ptp_init_pins_X550(adapter);
 #ifdef HAVE_PTP_CLOCK_INFO_ADJFINE
 		adapter->ptp_caps.adjfine = ixgbe_ptp_adjfine_X550;
 #else
@@ -1532,7 +2283,7 @@ static long ixgbe_ptp_create_clock(struct ixgbe_adapter *adapter)
 		adapter->ptp_caps.gettime = ixgbe_ptp_gettime32;
 		adapter->ptp_caps.settime = ixgbe_ptp_settime32;
 #endif /* !HAVE_PTP_CLOCK_INFO_GETTIME64 */
-		adapter->ptp_caps.enable = ixgbe_ptp_feature_enable;
+		adapter->ptp_caps.enable = ixgbe_ptp_feature_enable_X550;
 		adapter->ptp_setup_sdp = ixgbe_ptp_setup_sdp_X550;
 		break;
 	default:
@@ -1576,6 +2327,8 @@ void ixgbe_ptp_init(struct ixgbe_adapter *adapter)
 	 * device
 	 */
 	spin_lock_init(&adapter->tmreg_lock);
+	seqcount_init(&adapter->hw_tc_seq);
+	skb_queue_head_init(&adapter->ptp_tx_queue);
 
 	/* obtain a PTP device, or re-use an existing device */
 	if (ixgbe_ptp_create_clock(adapter))
@@ -1583,6 +2336,9 @@ void ixgbe_ptp_init(struct ixgbe_adapter *adapter)
 
 	/* we have a clock so we can initialize work now */
 	INIT_WORK(&adapter->ptp_tx_work, ixgbe_ptp_tx_hwtstamp_work);
+	INIT_WORK(&adapter->ptp_tx_resend_work, ixgbe_ptp_tx_resend_work);
+	hrtimer_setup(&adapter->ptp_tx_timer, ixgbe_ptp_tx_poll,
+		      CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 
 	/* reset the PTP related hardware bits */
 	ixgbe_ptp_reset(adapter);
@@ -1607,11 +2363,18 @@ void ixgbe_ptp_suspend(struct ixgbe_adapter *adapter)
 		return;
 
 	adapter->flags2 &= ~IXGBE_FLAG2_PTP_PPS_ENABLED;
+	memset(adapter->ptp_perout, 0, sizeof(adapter->ptp_perout));
+	adapter->ptp_extts_ena = 0;
 	if (adapter->ptp_setup_sdp)
 		adapter->ptp_setup_sdp(adapter);
 
-	/* ensure that we cancel any pending PTP Tx work item in progress */
+	/* ensure that we cancel any pending PTP Tx work item in progress, and
+	 * drop the packets still waiting for the timestamp slot
+	 */
+	hrtimer_cancel(&adapter->ptp_tx_timer);
 	cancel_work_sync(&adapter->ptp_tx_work);
+	cancel_work_sync(&adapter->ptp_tx_resend_work);
+	skb_queue_purge(&adapter->ptp_tx_queue);
 	ixgbe_ptp_clear_tx_timestamp(adapter);
 }
 
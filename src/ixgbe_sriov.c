@@ -14,6 +14,7 @@
 
 #include "ixgbe.h"
 #include "ixgbe_type.h"
+#include "ixgbe_dcb_82599.h"
 #include "ixgbe_sriov.h"
 
 static void ixgbe_set_vf_rx_tx(struct ixgbe_adapter *adapter, int vf);
@@ -132,6 +133,8 @@ static int __ixgbe_enable_sriov(struct ixgbe_adapter *adapter,
 
 		/* set the default xcast mode */
 		adapter->vfinfo[i].xcast_mode = IXGBEVF_XCAST_MODE_NONE;
+
+		spin_lock_init(&adapter->vfinfo[i].mbx_txq.lock);
 	}
 
 	e_dev_info("SR-IOV enabled with %d VFs\n", num_vfs);
@@ -247,6 +250,19 @@ int ixgbe_disable_sriov(struct ixgbe_adapter *adapter)
 		pci_dev_put(vfdev);
 	}
 
+	/* no more retries, then drop whatever the VFs did not pick up */
+	cancel_delayed_work_sync(&adapter->vf_stats_task);
+	cancel_delayed_work_sync(&adapter->mbx_task);
+	for (vf = 0; vf < num_vfs; ++vf) {
+		struct vf_data_storage *vfinfo = &adapter->vfinfo[vf];
+
+		ixgbe_vf_mbx_flush(adapter, vf);
+
+		/* release the MTA bits referenced by the VF */
+		ixgbe_mta_update(adapter, vfinfo->vf_mc_hashes,
+				 vfinfo->num_vf_mc_hashes, NULL, 0);
+	}
+
 	/* free VF control structures */
 	kfree(adapter->vfinfo);
 	adapter->vfinfo = NULL;
@@ -426,47 +442,43 @@ static int ixgbe_set_vf_multicasts(struct ixgbe_adapter *adapter,
 	/* only so many hash values supported */
 	entries = min(entries, IXGBE_MAX_VF_MC_ENTRIES);
 
-	/* salt away the number of multi cast addresses assigned
-	 * to this VF for later use to restore when the PF multi cast
-	 * list changes
+	/* VFs are limited to using the MTA hash table for their multicast
+	 * addresses, which is shared with the PF and the other VFs, so only
+	 * move the references that changed
 	 */
-	vfinfo->num_vf_mc_hashes = entries;
+	ixgbe_mta_update(adapter, vfinfo->vf_mc_hashes,
+			 vfinfo->num_vf_mc_hashes, hash_list, entries);
 
-	/* VFs are limited to using the MTA hash table for their multicast
-	 * addresses */
+	/* salt away the hashes assigned to this VF so that they can be
+	 * released on the next update or VF reset
+	 */
+	vfinfo->num_vf_mc_hashes = entries;
 	for (i = 0; i < entries; i++)
 		vfinfo->vf_mc_hashes[i] = hash_list[i];
 
 	vmolr |= IXGBE_VMOLR_ROMPE;
 	IXGBE_WRITE_REG(hw, IXGBE_VMOLR(vf), vmolr);
 
-	/* Sync up the PF and VF in the same MTA table */
-	ixgbe_write_mc_addr_list(adapter->netdev);
-
 	return 0;
 }
 
 #ifdef CONFIG_PCI_IOV
+/**
+ * ixgbe_restore_vf_multicasts - restore VF multicast state after a reset
+ * @adapter: pointer to adapter struct
+ *
+ * The VF hashes stay referenced in the MTA cache across a MAC reset and are
+ * rewritten by ixgbe_reset(), only the per pool enables need replaying.
+ **/
 void ixgbe_restore_vf_multicasts(struct ixgbe_adapter *adapter)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
 	struct vf_data_storage *vfinfo;
-	int i, j;
-	u32 vector_bit;
-	u32 vector_reg;
-
-	/* Clear mta_shadow */
-	memset(&hw->mac.mta_shadow, 0, sizeof(hw->mac.mta_shadow));
+	int i;
 
 	for (i = 0; i < adapter->num_vfs; i++) {
 		u32 vmolr = IXGBE_READ_REG(hw, IXGBE_VMOLR(i));
 		vfinfo = &adapter->vfinfo[i];
-		for (j = 0; j < vfinfo->num_vf_mc_hashes; j++) {
-			hw->addr_ctrl.mta_in_use++;
-			vector_reg = (vfinfo->vf_mc_hashes[j] >> 5) & 0x7F;
-			vector_bit = vfinfo->vf_mc_hashes[j] & 0x1F;
-			hw->mac.mta_shadow[vector_reg] |= (1 << vector_bit);
-		}
 		if (vfinfo->num_vf_mc_hashes)
 			vmolr |= IXGBE_VMOLR_ROMPE;
 		else
@@ -740,6 +752,200 @@ static int ixgbe_set_vf_macvlan(struct ixgbe_adapter *adapter,
 	return 0;
 }
 
+/**
+ * ixgbe_vf_mbx_post - Post the head of a VF's message queue
+ * @adapter: board private structure
+ * @vf: VF index
+ *
+ * Called with the queue lock held. Nothing is posted while the previous
+ * message waits for its ACK; if the mailbox is busy the message stays
+ * queued and is retried from the next mailbox event or ixgbe_vf_mbx_task.
+ **/
+static void ixgbe_vf_mbx_post(struct ixgbe_adapter *adapter, u32 vf)
+{
+	struct ixgbe_vf_mbx_txq *txq = &adapter->vfinfo[vf].mbx_txq;
+	struct ixgbe_vf_mbx_req *req;
+
+	if (txq->inflight || !txq->count)
+		return;
+
+	req = &txq->req[txq->head];
+	if (ixgbe_try_write_mbx_pf(&adapter->hw, req->msg, req->size, vf))
+		return;
+
+	txq->inflight = true;
+	txq->posted = jiffies;
+}
+
+/**
+ * ixgbe_vf_mbx_pop - Remove the head of a VF's message queue
+ * @adapter: board private structure
+ * @vf: VF index
+ * @req: storage for the removed request
+ * @inflight_only: only remove the head if it has been posted
+ *
+ * Returns true if a request was removed and copied to @req.
+ **/
+static bool ixgbe_vf_mbx_pop(struct ixgbe_adapter *adapter, u32 vf,
+			     struct ixgbe_vf_mbx_req *req, bool inflight_only)
+{
+	struct ixgbe_vf_mbx_txq *txq = &adapter->vfinfo[vf].mbx_txq;
+	unsigned long flags;
+	bool popped = false;
+
+	spin_lock_irqsave(&txq->lock, flags);
+	if (txq->count && (txq->inflight || !inflight_only)) {
+		*req = txq->req[txq->head];
+		txq->head = (txq->head + 1) % IXGBE_VF_MBX_TXQ_LEN;
+		txq->count--;
+		txq->inflight = false;
+		popped = true;
+	}
+	if (inflight_only)
+		ixgbe_vf_mbx_post(adapter, vf);
+	spin_unlock_irqrestore(&txq->lock, flags);
+
+	return popped;
+}
+
+/**
+ * ixgbe_vf_mbx_complete - Complete the posted message of a VF
+ * @adapter: board private structure
+ * @vf: VF index
+ * @status: 0 if the VF acknowledged the message, negative errno otherwise
+ *
+ * Runs the completion of the message and posts the next queued one.
+ **/
+static void ixgbe_vf_mbx_complete(struct ixgbe_adapter *adapter, u32 vf,
+				  int status)
+{
+	struct ixgbe_vf_mbx_req req;
+
+	if (ixgbe_vf_mbx_pop(adapter, vf, &req, true) && req.done)
+		req.done(adapter, vf, req.msg, status);
+}
+
+/**
+ * ixgbe_vf_mbx_flush - Drop all queued messages of a VF
+ * @adapter: board private structure
+ * @vf: VF index
+ **/
+static void ixgbe_vf_mbx_flush(struct ixgbe_adapter *adapter, u32 vf)
+{
+	struct ixgbe_vf_mbx_req req;
+
+	while (ixgbe_vf_mbx_pop(adapter, vf, &req, false))
+		if (req.done)
+			req.done(adapter, vf, req.msg, -ECONNRESET);
+}
+
+/**
+ * ixgbe_queue_vf_msg - Queue a message for a VF
+ * @adapter: board private structure
+ * @vf: VF index
+ * @msg: message to send
+ * @size: length of @msg in 32 bit words
+ * @done: optional completion, called once the VF has acked the message
+ *
+ * Messages to a VF are sent one at a time in the order they were queued.
+ * The caller never waits on the mailbox; the ACK interrupt completes the
+ * posted message and sends the next one.
+ **/
+static int ixgbe_queue_vf_msg(struct ixgbe_adapter *adapter, u32 vf,
+			      u32 *msg, u16 size, ixgbe_vf_mbx_done_t done)
+{
+	struct ixgbe_vf_mbx_txq *txq = &adapter->vfinfo[vf].mbx_txq;
+	struct ixgbe_vf_mbx_req *req;
+	unsigned long flags;
+
+	if (size > IXGBE_VFMAILBOX_SIZE)
+		return -EINVAL;
+
+	spin_lock_irqsave(&txq->lock, flags);
+	if (txq->count == IXGBE_VF_MBX_TXQ_LEN) {
+		spin_unlock_irqrestore(&txq->lock, flags);
+		if (net_ratelimit())
+			e_warn(drv, "VF %u mailbox queue full, dropping message %8.8x\n",
+			       vf, msg[0]);
+		return -EBUSY;
+	}
+
+	req = &txq->req[(txq->head + txq->count) % IXGBE_VF_MBX_TXQ_LEN];
+	memcpy(req->msg, msg, size * sizeof(u32));
+	req->size = size;
+	req->done = done;
+	txq->count++;
+
+	ixgbe_vf_mbx_post(adapter, vf);
+	spin_unlock_irqrestore(&txq->lock, flags);
+
+	/* expire the ACK wait or retry a busy mailbox later */
+	schedule_delayed_work(&adapter->mbx_task, 1);
+
+	return 0;
+}
+
+/**
+ * ixgbe_vf_mbx_task - Retry and time out queued VF messages
+ * @work: pointer to the mbx_task work struct
+ *
+ * Only runs while messages are queued. Messages that could not be posted
+ * are retried on the next tick and a message whose ACK has not arrived in
+ * IXGBE_VF_MBX_ACK_TIMEOUT is completed with -ETIMEDOUT.
+ **/
+void ixgbe_vf_mbx_task(struct work_struct *work)
+{
+	struct ixgbe_adapter *adapter = container_of(to_delayed_work(work),
+						     struct ixgbe_adapter,
+						     mbx_task);
+	bool retry = false, waiting = false;
+	u32 vf;
+
+	for (vf = 0; vf < adapter->num_vfs; vf++) {
+		struct ixgbe_vf_mbx_txq *txq = &adapter->vfinfo[vf].mbx_txq;
+		unsigned long flags;
+		bool expired;
+
+		spin_lock_irqsave(&txq->lock, flags);
+		expired = txq->inflight &&
+			  time_after(jiffies,
+				     txq->posted + IXGBE_VF_MBX_ACK_TIMEOUT);
+		if (!expired)
+			ixgbe_vf_mbx_post(adapter, vf);
+		if (txq->inflight)
+			waiting = true;
+		else if (txq->count)
+			retry = true;
+		spin_unlock_irqrestore(&txq->lock, flags);
+
+		if (expired) {
+			ixgbe_vf_mbx_complete(adapter, vf, -ETIMEDOUT);
+			retry = true;
+		}
+	}
+
+	if (retry)
+		schedule_delayed_work(&adapter->mbx_task, 1);
+	else if (waiting)
+		schedule_delayed_work(&adapter->mbx_task,
+				      IXGBE_VF_MBX_ACK_TIMEOUT);
+}
+
+/**
+ * ixgbe_ping_vf_done - Completion for PF control messages
+ * @adapter: board private structure
+ * @vf: VF index
+ * @msg: the control message
+ * @status: completion status
+ **/
+static void ixgbe_ping_vf_done(struct ixgbe_adapter *adapter, u32 vf,
+			       u32 __always_unused *msg, int status)
+{
+	if (status == -ETIMEDOUT)
+		e_dbg(drv, "VF %u did not acknowledge PF control message\n",
+		      vf);
+}
+
 static inline void ixgbe_vf_reset_event(struct ixgbe_adapter *adapter, u32 vf)
 {
 	struct ixgbe_ring_feature *vmdq = &adapter->ring_feature[RING_F_VMDQ];
@@ -772,8 +978,15 @@ static inline void ixgbe_vf_reset_event(struct ixgbe_adapter *adapter, u32 vf)
 					adapter->default_up, vf);
 	}
 
+	/* the VF starts over, name the filter state it is about to build */
+	if (!++adapter->vf_cfg_gen)
+		++adapter->vf_cfg_gen;
+	vfinfo->cfg_gen = adapter->vf_cfg_gen;
+
 	/* reset multicast table array for vf */
-	adapter->vfinfo[vf].num_vf_mc_hashes = 0;
+	ixgbe_mta_update(adapter, vfinfo->vf_mc_hashes,
+			 vfinfo->num_vf_mc_hashes, NULL, 0);
+	vfinfo->num_vf_mc_hashes = 0;
 
 	/* Flush and reset the mta with the new values */
 	ixgbe_set_rx_mode(adapter->netdev);
@@ -783,6 +996,10 @@ static inline void ixgbe_vf_reset_event(struct ixgbe_adapter *adapter, u32 vf)
 
 	/* reset VF api back to unknown */
 	adapter->vfinfo[vf].vf_api = ixgbe_mbox_api_10;
+	adapter->vfinfo[vf].priv_caps = 0;
+
+	/* messages queued before the reset are meaningless to the VF now */
+	ixgbe_vf_mbx_flush(adapter, vf);
 
 	/*
 	 * Toggling VF's TX queues and clearing VF Mailbox Memory after VFLR
@@ -868,25 +1085,59 @@ static inline void ixgbe_write_qde(struct ixgbe_adapter *adapter, u32 vf,
 
 }
 
-static int ixgbe_vf_reset_msg(struct ixgbe_adapter *adapter, u32 vf)
+/**
+ * ixgbe_vf_warm_reset_ok - check whether a VF reset may keep its filters
+ * @adapter: pointer to adapter struct
+ * @req: the reset request from the VF
+ * @vf: VF identifier
+ *
+ * The PF's copy of the VF's VLAN, MAC, multicast and xcast state is only
+ * trusted when the VF names the generation it was last given and nothing
+ * outside the VF's own requests (VFLR, PF reset, administrative changes)
+ * has touched that state since.
+ **/
+static bool ixgbe_vf_warm_reset_ok(struct ixgbe_adapter *adapter,
+				   u32 *req, u32 vf)
+{
+	struct vf_data_storage *vfinfo = &adapter->vfinfo[vf];
+
+	if (!(req[0] & (IXGBE_VF_RESET_WARM << IXGBE_VT_MSGINFO_SHIFT)))
+		return false;
+
+	return vfinfo->cfg_gen && req[1] == vfinfo->cfg_gen &&
+	       vfinfo->vf_api != ixgbe_mbox_api_10;
+}
+
+static int ixgbe_vf_reset_msg(struct ixgbe_adapter *adapter, u32 *req, u32 vf)
 {
 	struct ixgbe_hw *hw = &adapter->hw;
 	struct ixgbe_ring_feature *vmdq = &adapter->ring_feature[RING_F_VMDQ];
 	unsigned char *vf_mac = adapter->vfinfo[vf].vf_mac_addresses;
 	u32 reg, reg_offset, vf_shift;
-	u32 msgbuf[4] = {0, 0, 0, 0};
+	u32 msgbuf[IXGBE_VF_RESET_MSG_LEN] = { 0 };
 	u8 *addr = (u8 *)(&msgbuf[1]);
 	u32 q_per_pool = __ALIGN_MASK(1, ~vmdq->mask);
+	bool warm;
 	int i;
 
-	e_info(probe, "VF Reset msg received from vf %d\n", vf);
+	warm = ixgbe_vf_warm_reset_ok(adapter, req, vf);
+
+	e_info(probe, "VF %s reset msg received from vf %d\n",
+	       warm ? "warm" : "cold", vf);
 
-	/* reset the filters for the device */
-	ixgbe_vf_reset_event(adapter, vf);
+	if (warm) {
+		/* filters, API version and xcast mode stay as they are, only
+		 * what the VF reset itself cleared is programmed below
+		 */
+		ixgbe_vf_mbx_flush(adapter, vf);
+	} else {
+		/* reset the filters for the device */
+		ixgbe_vf_reset_event(adapter, vf);
 
-	/* set vf mac address */
-	if (!is_zero_ether_addr(vf_mac))
-		ixgbe_set_vf_mac(adapter, vf, vf_mac);
+		/* set vf mac address */
+		if (!is_zero_ether_addr(vf_mac))
+			ixgbe_set_vf_mac(adapter, vf, vf_mac);
+	}
 
 	vf_shift = vf % 32;
 	reg_offset = vf / 32;
@@ -926,12 +1177,17 @@ static int ixgbe_vf_reset_msg(struct ixgbe_adapter *adapter, u32 vf)
 		msgbuf[0] |= IXGBE_VT_MSGTYPE_FAILURE;
 	}
 
+	/* tell the VF its configuration is intact so it skips the replay */
+	if (warm)
+		msgbuf[0] |= IXGBE_VF_RESET_WARM << IXGBE_VT_MSGINFO_SHIFT;
+
 	/*
 	 * Piggyback the multicast filter type so VF can compute the
 	 * correct vectors
 	 */
-	msgbuf[3] = hw->mac.mc_filter_type;
-	ixgbe_write_mbx(hw, msgbuf, IXGBE_VF_PERMADDR_MSG_LEN, vf);
+	msgbuf[IXGBE_VF_MC_TYPE_WORD] = hw->mac.mc_filter_type;
+	msgbuf[IXGBE_VF_CFG_GEN_WORD] = adapter->vfinfo[vf].cfg_gen;
+	ixgbe_queue_vf_msg(adapter, vf, msgbuf, IXGBE_VF_RESET_MSG_LEN, NULL);
 
 	return 0;
 }
@@ -959,22 +1215,36 @@ static int ixgbe_set_vf_mac_addr(struct ixgbe_adapter *adapter,
 	return ixgbe_set_vf_mac(adapter, vf, new_mac) < 0;
 }
 
-static int ixgbe_set_vf_vlan_msg(struct ixgbe_adapter *adapter,
-				 u32 *msgbuf, u32 vf)
+/**
+ * ixgbe_vf_vlan_allowed - check whether a VF may manage its own VLANs
+ * @adapter: pointer to adapter struct
+ * @vf: VF identifier
+ **/
+static bool ixgbe_vf_vlan_allowed(struct ixgbe_adapter *adapter, u32 vf)
 {
-	u32 add = (msgbuf[0] & IXGBE_VT_MSGINFO_MASK) >> IXGBE_VT_MSGINFO_SHIFT;
-	u32 vid = (msgbuf[1] & IXGBE_VLVF_VLANID_MASK);
-	u8 tcs = netdev_get_num_tc(adapter->netdev);
-	int err = 0;
-
-	if (adapter->vfinfo[vf].pf_vlan || tcs) {
+	if (adapter->vfinfo[vf].pf_vlan || netdev_get_num_tc(adapter->netdev)) {
 		e_warn(drv,
 		       "VF %d attempted to override administratively set VLAN configuration\n"
 		       "Reload the VF driver to resume operations\n",
 		       vf);
-		return -1;
+		return false;
 	}
 
+	return true;
+}
+
+/**
+ * ixgbe_vf_vlan_update - add or remove one VLAN filter requested by a VF
+ * @adapter: pointer to adapter struct
+ * @add: true to add the filter, false to remove it
+ * @vid: VLAN ID
+ * @vf: VF identifier
+ **/
+static int ixgbe_vf_vlan_update(struct ixgbe_adapter *adapter, u32 add,
+				u32 vid, u32 vf)
+{
+	int err = 0;
+
 	/* VLAN 0 is a special case, don't allow it to be removed */
 	if (!vid && !add)
 		return 0;
@@ -1035,6 +1305,57 @@ out:
 	return err;
 }
 
+static int ixgbe_set_vf_vlan_msg(struct ixgbe_adapter *adapter,
+				 u32 *msgbuf, u32 vf)
+{
+	u32 add = (msgbuf[0] & IXGBE_VT_MSGINFO_MASK) >> IXGBE_VT_MSGINFO_SHIFT;
+	u32 vid = (msgbuf[1] & IXGBE_VLVF_VLANID_MASK);
+
+	if (!ixgbe_vf_vlan_allowed(adapter, vf))
+		return -1;
+
+	return ixgbe_vf_vlan_update(adapter, add, vid, vf);
+}
+
+/**
+ * ixgbe_set_vf_vlan_batch_msg - apply several VLAN filter changes at once
+ * @adapter: pointer to adapter struct
+ * @msgbuf: the request, overwritten with the reply
+ * @vf: VF identifier
+ *
+ * Each entry word holds a VLAN ID and IXGBE_VF_VLAN_BATCH_ADD.  The reply
+ * reports entries that failed as set bits in IXGBE_VF_BATCH_RESULT_WORD,
+ * the message as a whole only fails if it was malformed or not allowed.
+ **/
+static int ixgbe_set_vf_vlan_batch_msg(struct ixgbe_adapter *adapter,
+				       u32 *msgbuf, u32 vf)
+{
+	u32 count = (msgbuf[0] & IXGBE_VT_MSGINFO_MASK) >>
+		    IXGBE_VT_MSGINFO_SHIFT;
+	u32 failed = 0;
+	u32 i;
+
+	if (!(adapter->vfinfo[vf].priv_caps & IXGBE_VF_PRIV_CAP_BATCH) ||
+	    count > IXGBE_VF_VLAN_BATCH_MAX)
+		return -1;
+
+	if (!ixgbe_vf_vlan_allowed(adapter, vf))
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		u32 entry = msgbuf[IXGBE_VF_BATCH_ENTRY_WORD + i];
+		u32 vid = entry & IXGBE_VLVF_VLANID_MASK;
+		u32 add = !!(entry & IXGBE_VF_VLAN_BATCH_ADD);
+
+		if (ixgbe_vf_vlan_update(adapter, add, vid, vf))
+			failed |= BIT(i);
+	}
+
+	msgbuf[IXGBE_VF_BATCH_RESULT_WORD] = failed;
+
+	return 0;
+}
+
 static int ixgbe_set_vf_macvlan_msg(struct ixgbe_adapter *adapter,
 				    u32 *msgbuf, u32 vf)
 {
@@ -1079,6 +1400,76 @@ static int ixgbe_set_vf_macvlan_msg(struct ixgbe_adapter *adapter,
 	return err < 0;
 }
 
+/**
+ * ixgbe_set_vf_macvlan_batch_msg - add several MACVLAN filters at once
+ * @adapter: pointer to adapter struct
+ * @msgbuf: the request, overwritten with the reply
+ * @vf: VF identifier
+ *
+ * The addresses are packed back to back from IXGBE_VF_BATCH_ENTRY_WORD.
+ * IXGBE_VF_MACVLAN_BATCH_CLEAR drops the VF's filters before adding, the
+ * same as index 1 of a single IXGBE_VF_SET_MACVLAN.  Failed entries are
+ * reported as set bits in IXGBE_VF_BATCH_RESULT_WORD.
+ **/
+static int ixgbe_set_vf_macvlan_batch_msg(struct ixgbe_adapter *adapter,
+					  u32 *msgbuf, u32 vf)
+{
+	u32 info = (msgbuf[0] & IXGBE_VT_MSGINFO_MASK) >>
+		   IXGBE_VT_MSGINFO_SHIFT;
+	u32 count = info & ~IXGBE_VF_MACVLAN_BATCH_CLEAR;
+	u8 macs[IXGBE_VF_MACVLAN_BATCH_MAX][ETH_ALEN];
+	bool nospc = false;
+	u32 failed = 0;
+	u32 i;
+
+	if (!(adapter->vfinfo[vf].priv_caps & IXGBE_VF_PRIV_CAP_BATCH) ||
+	    count > IXGBE_VF_MACVLAN_BATCH_MAX)
+		return -1;
+
+	if (adapter->vfinfo[vf].pf_set_mac && !adapter->vfinfo[vf].trusted &&
+	    count) {
+		e_warn(drv,
+		       "VF %d requested MACVLAN filter but is administratively denied\n",
+		       vf);
+		return -1;
+	}
+
+	/* copy out before the reply overwrites the entries */
+	memcpy(macs, &msgbuf[IXGBE_VF_BATCH_ENTRY_WORD], count * ETH_ALEN);
+
+	if (info & IXGBE_VF_MACVLAN_BATCH_CLEAR)
+		ixgbe_set_vf_macvlan(adapter, vf, 0, NULL);
+
+	/* see ixgbe_set_vf_macvlan_msg() */
+	if (count && adapter->vfinfo[vf].spoofchk_enabled) {
+		struct ixgbe_hw *hw = &adapter->hw;
+
+		hw->mac.ops.set_mac_anti_spoofing(hw, false, vf);
+		hw->mac.ops.set_vlan_anti_spoofing(hw, false, vf);
+	}
+
+	for (i = 0; i < count; i++) {
+		int err = -EINVAL;
+
+		/* index 2 adds without dropping the existing filters */
+		if (is_valid_ether_addr(macs[i]))
+			err = ixgbe_set_vf_macvlan(adapter, vf, 2, macs[i]);
+		if (err) {
+			failed |= BIT(i);
+			nospc |= err == -ENOSPC;
+		}
+	}
+
+	if (nospc)
+		e_warn(drv,
+		       "VF %d has requested a MACVLAN filter but there is no space for it\n",
+		       vf);
+
+	msgbuf[IXGBE_VF_BATCH_RESULT_WORD] = failed;
+
+	return 0;
+}
+
 static int ixgbe_negotiate_vf_api(struct ixgbe_adapter *adapter,
 				  u32 *msgbuf, u32 vf)
 {
@@ -1090,6 +1481,7 @@ static int ixgbe_negotiate_vf_api(struct ixgbe_adapter *adapter,
 	case ixgbe_mbox_api_12:
 	case ixgbe_mbox_api_13:
 		adapter->vfinfo[vf].vf_api = api;
+		adapter->vfinfo[vf].priv_caps = 0;
 		return 0;
 	default:
 		break;
@@ -1100,6 +1492,47 @@ static int ixgbe_negotiate_vf_api(struct ixgbe_adapter *adapter,
 	return -1;
 }
 
+/**
+ * ixgbe_get_vf_priv_caps - agree on requests private to this driver
+ * @adapter: pointer to adapter struct
+ * @msgbuf: the request, overwritten with the reply
+ * @vf: VF identifier
+ *
+ * Word 1 carries the capabilities the VF speaks and returns the subset the
+ * PF accepted.  A stock VF never sends this request, so it never sees the
+ * private requests, whatever API version it negotiated.
+ **/
+static int ixgbe_get_vf_priv_caps(struct ixgbe_adapter *adapter,
+				  u32 *msgbuf, u32 vf)
+{
+	adapter->vfinfo[vf].priv_caps = msgbuf[1] &
+					IXGBE_VF_PRIV_CAPS_SUPPORTED;
+	msgbuf[1] = adapter->vfinfo[vf].priv_caps;
+
+	return 0;
+}
+
+/**
+ * ixgbe_vf_queue_count - number of RSS queues offered to a VF
+ * @adapter: pointer to adapter struct
+ * @vf: VF identifier
+ *
+ * Pools are uniform in hardware, but a VF programs the RSS width of its own
+ * pool (PSRTYPE.RQPL) from the queue count we report, so a VF limited to
+ * fewer queues than the pool holds only ever receives on that many.
+ **/
+u8 ixgbe_vf_queue_count(struct ixgbe_adapter *adapter, u32 vf)
+{
+	struct ixgbe_ring_feature *vmdq = &adapter->ring_feature[RING_F_VMDQ];
+	u8 pool_queues = __ALIGN_MASK(1, ~vmdq->mask);
+	u8 num_queues = adapter->vfinfo[vf].num_queues;
+
+	if (!num_queues || num_queues > pool_queues)
+		return pool_queues;
+
+	return num_queues;
+}
+
 static int ixgbe_get_vf_queues(struct ixgbe_adapter *adapter,
 			       u32 *msgbuf, u32 vf)
 {
@@ -1119,13 +1552,17 @@ static int ixgbe_get_vf_queues(struct ixgbe_adapter *adapter,
 		return -1;
 	}
 
-	/* only allow 1 Tx queue for bandwidth limiting */
-	msgbuf[IXGBE_VF_TX_QUEUES] = __ALIGN_MASK(1, ~vmdq->mask);
-	msgbuf[IXGBE_VF_RX_QUEUES] = __ALIGN_MASK(1, ~vmdq->mask);
+	/* with TCs every queue in the pool maps to a traffic class */
+	if (num_tcs > 1) {
+		msgbuf[IXGBE_VF_TX_QUEUES] = __ALIGN_MASK(1, ~vmdq->mask);
+		msgbuf[IXGBE_VF_RX_QUEUES] = __ALIGN_MASK(1, ~vmdq->mask);
 
-	/* if TCs > 1 determine which TC belongs to default user priority */
-	if (num_tcs > 1)
+		/* determine which TC belongs to default user priority */
 		default_tc = netdev_get_prio_tc_map(dev, adapter->default_up);
+	} else {
+		msgbuf[IXGBE_VF_TX_QUEUES] = ixgbe_vf_queue_count(adapter, vf);
+		msgbuf[IXGBE_VF_RX_QUEUES] = ixgbe_vf_queue_count(adapter, vf);
+	}
 
 	/* notify VF of need for VLAN tag stripping, and correct queue */
 	if (num_tcs)
@@ -1148,6 +1585,7 @@ static int ixgbe_get_vf_reta(struct ixgbe_adapter *adapter, u32 *msgbuf, u32 vf)
 	u32 *out_buf = &msgbuf[1];
 	const u8 *reta = adapter->rss_indir_tbl;
 	u32 reta_size = ixgbe_rss_indir_tbl_entries(adapter);
+	u32 mask = ixgbe_vf_queue_count(adapter, vf) - 1;
 
 	/* Check if operation is permitted */
 	if (!adapter->vfinfo[vf].rss_query_enabled)
@@ -1165,12 +1603,14 @@ static int ixgbe_get_vf_reta(struct ixgbe_adapter *adapter, u32 *msgbuf, u32 vf)
 	/* This mailbox command is supported (required) only for 82599 and x540
 	 * VFs which support up to 4 RSS queues. Therefore we will compress the
 	 * RETA by saving only 2 bits from each entry. This way we will be able
-	 * to transfer the whole RETA in a single mailbox operation.
+	 * to transfer the whole RETA in a single mailbox operation.  The VF
+	 * only hashes across the queues it was given, so report the entries
+	 * the way its pool resolves them.
 	 */
 	for (i = 0; i < reta_size / 16; i++) {
 		out_buf[i] = 0;
 		for (j = 0; j < 16; j++)
-			out_buf[i] |= (u32)(reta[16 * i + j] & 0x3) << (2 * j);
+			out_buf[i] |= (reta[16 * i + j] & mask & 0x3) << (2 * j);
 	}
 
 	return 0;
@@ -1315,8 +1755,10 @@ static int ixgbe_rcv_msg_from_vf(struct ixgbe_adapter *adapter, u32 vf)
 	/* flush the ack before we write any messages back */
 	IXGBE_WRITE_FLUSH(hw);
 
-	if (msgbuf[0] == IXGBE_VF_RESET)
-		return ixgbe_vf_reset_msg(adapter, vf);
+	if (msgbuf[0] == IXGBE_VF_RESET ||
+	    msgbuf[0] == (IXGBE_VF_RESET |
+			  IXGBE_VF_RESET_WARM << IXGBE_VT_MSGINFO_SHIFT))
+		return ixgbe_vf_reset_msg(adapter, msgbuf, vf);
 
 	/*
 	 * until the vf completes a virtual function reset it should not be
@@ -1325,7 +1767,7 @@ static int ixgbe_rcv_msg_from_vf(struct ixgbe_adapter *adapter, u32 vf)
 
 	if (!adapter->vfinfo[vf].clear_to_send) {
 		msgbuf[0] |= IXGBE_VT_MSGTYPE_FAILURE;
-		ixgbe_write_mbx(hw, msgbuf, 1, vf);
+		ixgbe_queue_vf_msg(adapter, vf, msgbuf, 1, NULL);
 		return retval;
 	}
 
@@ -1349,9 +1791,18 @@ static int ixgbe_rcv_msg_from_vf(struct ixgbe_adapter *adapter, u32 vf)
 	case IXGBE_VF_SET_MACVLAN:
 		retval = ixgbe_set_vf_macvlan_msg(adapter, msgbuf, vf);
 		break;
+	case IXGBE_VF_SET_VLAN_BATCH:
+		retval = ixgbe_set_vf_vlan_batch_msg(adapter, msgbuf, vf);
+		break;
+	case IXGBE_VF_SET_MACVLAN_BATCH:
+		retval = ixgbe_set_vf_macvlan_batch_msg(adapter, msgbuf, vf);
+		break;
 	case IXGBE_VF_API_NEGOTIATE:
 		retval = ixgbe_negotiate_vf_api(adapter, msgbuf, vf);
 		break;
+	case IXGBE_VF_PRIV_CAPS:
+		retval = ixgbe_get_vf_priv_caps(adapter, msgbuf, vf);
+		break;
 	case IXGBE_VF_GET_QUEUES:
 		retval = ixgbe_get_vf_queues(adapter, msgbuf, vf);
 		break;
@@ -1383,19 +1834,21 @@ static int ixgbe_rcv_msg_from_vf(struct ixgbe_adapter *adapter, u32 vf)
 
 	msgbuf[0] |= IXGBE_VT_MSGTYPE_CTS;
 
-	ixgbe_write_mbx(hw, msgbuf, mbx_size, vf);
+	ixgbe_queue_vf_msg(adapter, vf, msgbuf, mbx_size, NULL);
 
 	return retval;
 }
 
 static void ixgbe_rcv_ack_from_vf(struct ixgbe_adapter *adapter, u32 vf)
 {
-	struct ixgbe_hw *hw = &adapter->hw;
 	u32 msg = IXGBE_VT_MSGTYPE_FAILURE;
 
+	/* the VF has read the message we posted, send the next one */
+	ixgbe_vf_mbx_complete(adapter, vf, 0);
+
 	/* if device isn't clear to send it shouldn't be reading either */
 	if (!adapter->vfinfo[vf].clear_to_send)
-		ixgbe_write_mbx(hw, &msg, 1, vf);
+		ixgbe_queue_vf_msg(adapter, vf, &msg, 1, NULL);
 }
 
 #define Q_BITMAP_DEPTH 2
@@ -1437,7 +1890,8 @@ int ixgbe_check_mdd_event(struct ixgbe_adapter *adapter)
 				adapter->vfinfo[vf].clear_to_send = 0;
 				ping = IXGBE_PF_CONTROL_MSG |
 				       IXGBE_VT_MSGTYPE_CTS;
-				ixgbe_write_mbx(hw, &ping, 1, vf);
+				ixgbe_queue_vf_msg(adapter, vf, &ping, 1,
+						   ixgbe_ping_vf_done);
 			}
 
 			retval = true;
@@ -1447,17 +1901,82 @@ int ixgbe_check_mdd_event(struct ixgbe_adapter *adapter)
 	return retval;
 }
 
+/**
+ * ixgbe_get_pending_vfs - Find the VFs with mailbox or reset events
+ * @adapter: board private structure
+ * @pending: bitmap of IXGBE_MAX_VF_FUNCTIONS bits to fill
+ *
+ * Each PFMBICR register carries the request and ack bits of 16 VFs and
+ * each VFLRE register the reset bits of 32 VFs, so a handful of reads
+ * replaces polling every VF's status individually.
+ */
+static void ixgbe_get_pending_vfs(struct ixgbe_adapter *adapter,
+				  unsigned long *pending)
+{
+	struct ixgbe_hw *hw = &adapter->hw;
+	u32 last = adapter->num_vfs - 1;
+	u32 i, bits, vflre;
+
+	for (i = 0; i <= IXGBE_PFMBICR_INDEX(last); i++) {
+		bits = IXGBE_READ_REG(hw, IXGBE_PFMBICR(i));
+		bits = (bits | (bits >> 16)) & IXGBE_PFMBICR_VFREQ_MASK;
+		while (bits) {
+			u32 shift = __ffs(bits);
+
+			set_bit(i * 16 + shift, pending);
+			bits &= ~BIT(shift);
+		}
+	}
+
+	for (i = 0; i <= IXGBE_PFVFLRE_INDEX(last); i++) {
+		if (hw->mac.type == ixgbe_mac_82599EB)
+			vflre = IXGBE_READ_REG(hw, IXGBE_PFVFLRE(i));
+		else
+			vflre = IXGBE_READ_REG(hw, IXGBE_PFVFLREC(i));
+		while (vflre) {
+			u32 shift = __ffs(vflre);
+
+			set_bit(i * 32 + shift, pending);
+			vflre &= ~BIT(shift);
+		}
+	}
+}
+
+/**
+ * ixgbe_msg_task - Service VF mailbox and reset events
+ * @adapter: board private structure
+ *
+ * Runs in the misc vector's IRQ thread, so the events of every VF are
+ * handled one after the other and in the order the hardware posted them.
+ */
 void ixgbe_msg_task(struct ixgbe_adapter *adapter)
 {
+	DECLARE_BITMAP(pending, IXGBE_MAX_VF_FUNCTIONS) = { 0 };
 	struct ixgbe_hw *hw = &adapter->hw;
 	u32 vf;
 
-	if (!adapter->vfinfo)
+	if (!adapter->vfinfo || !adapter->num_vfs)
 		return;
-	if (adapter->flags & IXGBE_FLAG_MDD_ENABLED)
-		ixgbe_check_mdd_event(adapter);
 
-	for (vf = 0; vf < adapter->num_vfs; vf++) {
+	ixgbe_get_pending_vfs(adapter, pending);
+
+	/* MDD events raise the mailbox cause without a VF event behind it,
+	 * so only an otherwise empty interrupt needs the queue scan.  When
+	 * the two coincide the scan is deferred to the next interrupt, which
+	 * the watchdog raises if nothing else does, and then done no matter
+	 * what else that interrupt carries.
+	 */
+	if (adapter->flags & IXGBE_FLAG_MDD_ENABLED) {
+		if (bitmap_empty(pending, adapter->num_vfs) ||
+		    adapter->flags2 & IXGBE_FLAG2_MDD_RECHECK) {
+			adapter->flags2 &= ~IXGBE_FLAG2_MDD_RECHECK;
+			ixgbe_check_mdd_event(adapter);
+		} else if (hw->mac.ops.mdd_event) {
+			adapter->flags2 |= IXGBE_FLAG2_MDD_RECHECK;
+		}
+	}
+
+	for_each_set_bit(vf, pending, adapter->num_vfs) {
 		/* process any reset requests */
 		if (!ixgbe_check_for_rst(hw, vf))
 			ixgbe_vf_reset_event(adapter, vf);
@@ -1472,33 +1991,72 @@ void ixgbe_msg_task(struct ixgbe_adapter *adapter)
 	}
 }
 
-#if defined(HAVE_NDO_SET_VF_TRUST) || defined(HAVE_NDO_SET_VF_LINK_STATE)
 static inline void ixgbe_ping_vf(struct ixgbe_adapter *adapter, int vf)
 {
-	struct ixgbe_hw *hw = &adapter->hw;
 	u32 ping;
 
 	ping = IXGBE_PF_CONTROL_MSG;
 	if (adapter->vfinfo[vf].clear_to_send)
 		ping |= IXGBE_VT_MSGTYPE_CTS;
-	ixgbe_write_mbx(hw, &ping, 1, vf);
+	ixgbe_queue_vf_msg(adapter, vf, &ping, 1, ixgbe_ping_vf_done);
 }
-#endif
 
 void ixgbe_ping_all_vfs(struct ixgbe_adapter *adapter)
 {
-	struct ixgbe_hw *hw = &adapter->hw;
 	u32 ping;
 	int i;
 
 	for (i = 0 ; i < adapter->num_vfs; i++) {
-		ping = IXGBE_PF_CONTROL_MSG;
-		if (adapter->vfinfo[i].clear_to_send)
-			ping |= IXGBE_VT_MSGTYPE_CTS;
-		ixgbe_write_mbx(hw, &ping, 1, i);
+		/* a VF that is not clear to send has no driver bound or is
+		 * still in reset, it would never ACK the ping
+		 */
+		if (!adapter->vfinfo[i].clear_to_send)
+			continue;
+
+		ping = IXGBE_PF_CONTROL_MSG | IXGBE_VT_MSGTYPE_CTS;
+		ixgbe_queue_vf_msg(adapter, i, &ping, 1, ixgbe_ping_vf_done);
 	}
 }
 
+/**
+ * ixgbe_set_vf_queues - limit the number of RSS queues used by a VF
+ * @adapter: pointer to adapter struct
+ * @vf: VF identifier
+ * @num_queues: power of 2 queue count up to the pool size, 0 for the default
+ *
+ * The VF is reset so that it renegotiates its queues with the new limit.
+ **/
+int ixgbe_set_vf_queues(struct ixgbe_adapter *adapter, int vf, u8 num_queues)
+{
+	struct ixgbe_ring_feature *vmdq = &adapter->ring_feature[RING_F_VMDQ];
+	u8 pool_queues = __ALIGN_MASK(1, ~vmdq->mask);
+
+	if (vf < 0 || vf >= adapter->num_vfs)
+		return -EINVAL;
+
+	if (num_queues > pool_queues || hweight8(num_queues) > 1) {
+		e_err(drv, "VF %d queue count must be a power of 2 no larger than %u\n",
+		      vf, pool_queues);
+		return -EINVAL;
+	}
+
+	/* nothing to do */
+	if (adapter->vfinfo[vf].num_queues == num_queues)
+		return 0;
+
+	adapter->vfinfo[vf].num_queues = num_queues;
+
+	/* reset VF to renegotiate its queues */
+	adapter->vfinfo[vf].cfg_gen = 0;
+	adapter->vfinfo[vf].clear_to_send = false;
+	ixgbe_ping_vf(adapter, vf);
+
+	e_info(drv, "VF %d limited to %u queues\n", vf,
+	       ixgbe_vf_queue_count(adapter, vf));
+
+	return 0;
+}
+
 /**
  * ixgbe_set_all_vfs - update vfs queues
  * @adapter: Pointer to adapter struct
@@ -1530,6 +2088,7 @@ int ixgbe_ndo_set_vf_trust(struct net_device *netdev, int vf, bool setting)
 	adapter->vfinfo[vf].trusted = setting;
 
 	/* reset VF to reconfigure features */
+	adapter->vfinfo[vf].cfg_gen = 0;
 	adapter->vfinfo[vf].clear_to_send = false;
 	ixgbe_ping_vf(adapter, vf);
 
@@ -1548,6 +2107,9 @@ int ixgbe_ndo_set_vf_mac(struct net_device *netdev, int vf, u8 *mac)
 	if (vf < 0 || vf >= adapter->num_vfs)
 		return -EINVAL;
 
+	/* the VF has to pick the new address up with a full reset */
+	adapter->vfinfo[vf].cfg_gen = 0;
+
 	if (is_valid_ether_addr(mac)) {
 		dev_info(ixgbe_pf_to_dev(adapter), "setting MAC %pM on VF %d\n",
 			 mac, vf);
@@ -1610,6 +2172,7 @@ static int ixgbe_enable_port_vlan(struct ixgbe_adapter *adapter,
 				IXGBE_QDE_HIDE_VLAN);
 	adapter->vfinfo[vf].pf_vlan = vlan;
 	adapter->vfinfo[vf].pf_qos = qos;
+	adapter->vfinfo[vf].cfg_gen = 0;
 	dev_info(ixgbe_pf_to_dev(adapter),
 		 "Setting VLAN %d, QOS 0x%x on VF %d\n", vlan, qos, vf);
 	if (test_bit(__IXGBE_DOWN, adapter->state)) {
@@ -1639,6 +2202,7 @@ static int ixgbe_disable_port_vlan(struct ixgbe_adapter *adapter, int vf)
 
 	adapter->vfinfo[vf].pf_vlan = 0;
 	adapter->vfinfo[vf].pf_qos = 0;
+	adapter->vfinfo[vf].cfg_gen = 0;
 
 	return err;
 }
@@ -1706,8 +2270,10 @@ static void ixgbe_set_vf_rate_limit(struct ixgbe_adapter *adapter, int vf)
 	u32 bcnrc_val = 0;
 	u16 queue, queues_per_pool;
 	u16 tx_rate = adapter->vfinfo[vf].tx_rate;
+	u32 mmw_size;
 
-	if (tx_rate) {
+	/* the rate scheduler is only used while linked at 10Gbps */
+	if (tx_rate && adapter->vf_rate_link_speed == 10000) {
 		/* start with base link speed value */
 		bcnrc_val = adapter->vf_rate_link_speed;
 
@@ -1726,18 +2292,23 @@ static void ixgbe_set_vf_rate_limit(struct ixgbe_adapter *adapter, int vf)
 	/*
 	 * Set global transmit compensation time to the MMW_SIZE in RTTBCNRM
 	 * register. Typically MMW_SIZE=0x014 if 9728-byte jumbo is supported
-	 * and 0x004 otherwise.
+	 * and 0x004 otherwise. A configured burst size overrides it.
 	 */
 	switch (hw->mac.type) {
 	case ixgbe_mac_82599EB:
-		IXGBE_WRITE_REG(hw, IXGBE_RTTBCNRM, 0x4);
+		mmw_size = 0x4;
 		break;
 	case ixgbe_mac_X540:
-		IXGBE_WRITE_REG(hw, IXGBE_RTTBCNRM, 0x14);
+		mmw_size = 0x14;
 		break;
 	default:
+		mmw_size = 0;
 		break;
 	}
+	if (adapter->vf_rate_burst)
+		mmw_size = adapter->vf_rate_burst;
+	if (mmw_size)
+		IXGBE_WRITE_REG(hw, IXGBE_RTTBCNRM, mmw_size);
 
 	/* determine how many queues per pool based on VMDq mask */
 	queues_per_pool = __ALIGN_MASK(1, ~vmdq->mask);
@@ -1751,63 +2322,196 @@ static void ixgbe_set_vf_rate_limit(struct ixgbe_adapter *adapter, int vf)
 	}
 }
 
+/**
+ * ixgbe_set_vf_min_rates - Program the pool arbiter for VF minimum rates
+ * @adapter: board private structure
+ *
+ * Minimum rates are guaranteed through the weighted round robin arbiter
+ * between pools. A VF with a minimum rate gets a weight equal to that
+ * rate; every other pool, the PF's included, gets an equal part of the
+ * remaining link bandwidth. Under contention each pool is then served in
+ * proportion to its weight. Weights are turned into credits the same way
+ * ixgbe_dcb_calculate_tc_credits() does for traffic classes. Without any
+ * minimum rate the arbiter is left in plain round robin.
+ **/
+static void ixgbe_set_vf_min_rates(struct ixgbe_adapter *adapter)
+{
+	int max_frame = adapter->netdev->mtu + ETH_HLEN + ETH_FCS_LEN;
+	u32 num_pools = adapter->num_vfs + adapter->num_rx_pools;
+	u32 link_speed = adapter->vf_rate_link_speed;
+	struct ixgbe_hw *hw = &adapter->hw;
+	u32 min_sum = 0, min_vfs = 0;
+	u32 share = 0, min_weight = 0;
+	u32 rttdcs, pool, weight;
+	u16 min_credit, credit;
+	int vf;
+
+	/* with DCB the per pool credits belong to the DCB configuration */
+	if (netdev_get_num_tc(adapter->netdev) > 1)
+		return;
+
+	for (vf = 0; vf < adapter->num_vfs; vf++) {
+		if (!adapter->vfinfo[vf].min_tx_rate)
+			continue;
+		min_sum += adapter->vfinfo[vf].min_tx_rate;
+		min_vfs++;
+	}
+
+	/* disable the arbiter while changing the credits */
+	rttdcs = IXGBE_READ_REG(hw, IXGBE_RTTDCS);
+	IXGBE_WRITE_REG(hw, IXGBE_RTTDCS, rttdcs | IXGBE_RTTDCS_ARBDIS);
+
+	if (!min_sum || !link_speed) {
+		for (pool = 0; pool < num_pools; pool++) {
+			IXGBE_WRITE_REG(hw, IXGBE_RTTDQSEL, pool);
+			IXGBE_WRITE_REG(hw, IXGBE_RTTDT1C, 0);
+		}
+		rttdcs &= ~IXGBE_RTTDCS_VMPAC;
+		goto out;
+	}
+
+	if (link_speed > min_sum)
+		share = (link_speed - min_sum) / (num_pools - min_vfs);
+	if (!share) {
+		e_warn(drv, "VF minimum rates exceed the %u Mbps link, they are scaled down\n",
+		       link_speed);
+		share = 1;
+	}
+
+	min_credit = ((max_frame / 2) + IXGBE_DCB_CREDIT_QUANTUM - 1) /
+		     IXGBE_DCB_CREDIT_QUANTUM;
+
+	min_weight = share;
+	for (vf = 0; vf < adapter->num_vfs; vf++) {
+		weight = adapter->vfinfo[vf].min_tx_rate;
+		if (weight && weight < min_weight)
+			min_weight = weight;
+	}
+
+	for (pool = 0; pool < num_pools; pool++) {
+		weight = share;
+		if (pool < adapter->num_vfs && adapter->vfinfo[pool].min_tx_rate)
+			weight = adapter->vfinfo[pool].min_tx_rate;
+
+		credit = min_t(u32, DIV_ROUND_UP(weight * min_credit, min_weight),
+			       IXGBE_DCB_MAX_CREDIT_REFILL);
+		if (credit < min_credit)
+			credit = min_credit;
+
+		IXGBE_WRITE_REG(hw, IXGBE_RTTDQSEL, pool);
+		IXGBE_WRITE_REG(hw, IXGBE_RTTDT1C, credit);
+	}
+	rttdcs |= IXGBE_RTTDCS_VMPAC;
+
+out:
+	rttdcs &= ~IXGBE_RTTDCS_ARBDIS;
+	IXGBE_WRITE_REG(hw, IXGBE_RTTDCS, rttdcs);
+}
+
+static bool ixgbe_vf_rates_set(struct ixgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_vfs; i++)
+		if (adapter->vfinfo[i].tx_rate ||
+		    adapter->vfinfo[i].min_tx_rate)
+			return true;
+
+	return false;
+}
+
+/**
+ * ixgbe_check_vf_rate_limit - Reprogram VF rates after a link change
+ * @adapter: board private structure
+ *
+ * Called on link up. The configured rates are kept across speed changes
+ * and recomputed for the new link speed. Maximum rates are suspended
+ * while the link is not at 10Gbps and restored when it is again.
+ **/
 void ixgbe_check_vf_rate_limit(struct ixgbe_adapter *adapter)
 {
+	int link_speed = ixgbe_link_mbps(adapter);
 	int i;
 
 	/* VF Tx rate limit was not set */
-	if (!adapter->vf_rate_link_speed)
+	if (!ixgbe_vf_rates_set(adapter))
 		return;
 
-	if (ixgbe_link_mbps(adapter) != adapter->vf_rate_link_speed) {
-		adapter->vf_rate_link_speed = 0;
+	if (link_speed != adapter->vf_rate_link_speed)
 		dev_info(ixgbe_pf_to_dev(adapter),
-			 "Link speed has been changed. VF Transmit rate is disabled\n");
-	}
-
-	for (i = 0; i < adapter->num_vfs; i++) {
-		if (!adapter->vf_rate_link_speed)
-			adapter->vfinfo[i].tx_rate = 0;
+			 "Link speed has been changed. VF Transmit rates are recomputed for %d Mbps%s\n",
+			 link_speed,
+			 link_speed != 10000 ? ", maximum rates are suspended" : "");
+	adapter->vf_rate_link_speed = link_speed;
 
+	for (i = 0; i < adapter->num_vfs; i++)
 		ixgbe_set_vf_rate_limit(adapter, i);
-	}
+
+	ixgbe_set_vf_min_rates(adapter);
 }
 
 #ifdef HAVE_NDO_SET_VF_MIN_MAX_TX_RATE
 int ixgbe_ndo_set_vf_bw(struct net_device *netdev,
 			int vf,
-			int __always_unused min_tx_rate,
+			int min_tx_rate,
 			int max_tx_rate)
 #else
 int ixgbe_ndo_set_vf_bw(struct net_device *netdev, int vf, int max_tx_rate)
 #endif /* HAVE_NDO_SET_VF_MIN_MAX_TX_RATE */
 {
 	struct ixgbe_adapter *adapter = netdev_priv(netdev);
-	int link_speed;
+	int link_speed, min_sum = 0, i;
+#ifndef HAVE_NDO_SET_VF_MIN_MAX_TX_RATE
+	int min_tx_rate;
+#endif
 
 	/* verify VF is active */
 	if (vf < 0 || vf >= adapter->num_vfs)
 		return -EINVAL;
 
+#ifndef HAVE_NDO_SET_VF_MIN_MAX_TX_RATE
+	min_tx_rate = adapter->vfinfo[vf].min_tx_rate;
+#endif
+
 	/* verify link is up */
 	if (!adapter->link_up)
 		return -EINVAL;
 
-	/* verify we are linked at 10Gbps */
+	/* the rate scheduler for max rates needs a 10Gbps link */
 	link_speed = ixgbe_link_mbps(adapter);
-	if (link_speed != 10000)
+	if (max_tx_rate && link_speed != 10000)
 		return -EINVAL;
 
 	/* rate limit cannot be less than 10Mbs or greater than link speed */
 	if (max_tx_rate && ((max_tx_rate <= 10) || (max_tx_rate > link_speed)))
 		return -EINVAL;
 
+	/* a guarantee above the limit can never be met */
+	if (min_tx_rate < 0 || (max_tx_rate && min_tx_rate > max_tx_rate))
+		return -EINVAL;
+
+	/* minimum rates use the pool arbiter, which DCB reprograms */
+	if (min_tx_rate && netdev_get_num_tc(netdev) > 1)
+		return -EOPNOTSUPP;
+
+	/* the guarantees of all VFs together must fit in the link */
+	for (i = 0; i < adapter->num_vfs; i++)
+		if (i != vf)
+			min_sum += adapter->vfinfo[i].min_tx_rate;
+	if (min_sum + min_tx_rate > link_speed) {
+		e_err(drv, "VF %d minimum rate %d Mbps exceeds the %d Mbps left on the link\n",
+		      vf, min_tx_rate, link_speed - min_sum);
+		return -EINVAL;
+	}
+
 	/* store values */
 	adapter->vf_rate_link_speed = link_speed;
 	adapter->vfinfo[vf].tx_rate = max_tx_rate;
+	adapter->vfinfo[vf].min_tx_rate = min_tx_rate;
 
 	/* update hardware configuration */
 	ixgbe_set_vf_rate_limit(adapter, vf);
+	ixgbe_set_vf_min_rates(adapter);
 
 	return 0;
 }
@@ -2022,7 +2726,7 @@ int ixgbe_ndo_get_vf_config(struct net_device *netdev,
 
 #ifdef HAVE_NDO_SET_VF_MIN_MAX_TX_RATE
 	ivi->max_tx_rate = adapter->vfinfo[vf].tx_rate;
-	ivi->min_tx_rate = 0;
+	ivi->min_tx_rate = adapter->vfinfo[vf].min_tx_rate;
 #else
 	ivi->tx_rate = adapter->vfinfo[vf].tx_rate;
 #endif /* HAVE_NDO_SET_VF_MIN_MAX_TX_RATE */
@@ -17,10 +17,13 @@ int ixgbe_set_vf_vlan(struct ixgbe_adapter *adapter, int add, int vid, u32 vf);
 void ixgbe_set_vmolr(struct ixgbe_hw *hw, u32 vf, bool aupe);
 int ixgbe_check_mdd_event(struct ixgbe_adapter *adapter);
 void ixgbe_msg_task(struct ixgbe_adapter *adapter);
+void ixgbe_vf_mbx_task(struct work_struct *work);
 int ixgbe_set_vf_mac(struct ixgbe_adapter *adapter,
 		     int vf, unsigned char *mac_addr);
 void ixgbe_ping_all_vfs(struct ixgbe_adapter *adapter);
 void ixgbe_set_all_vfs(struct ixgbe_adapter *adapter);
+u8 ixgbe_vf_queue_count(struct ixgbe_adapter *adapter, u32 vf);
+int ixgbe_set_vf_queues(struct ixgbe_adapter *adapter, int vf, u8 num_queues);
 #ifdef IFLA_VF_MAX
 int ixgbe_ndo_set_vf_mac(struct net_device *netdev, int queue, u8 *mac);
 #ifdef IFLA_VF_VLAN_INFO_MAX
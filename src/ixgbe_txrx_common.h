@@ -71,6 +71,7 @@ void ixgbe_rx_skb(struct ixgbe_q_vector *q_vector,
 		  struct ixgbe_ring *rx_ring,
 		  union ixgbe_adv_rx_desc *rx_desc,
 		  struct sk_buff *skb);
+void ixgbe_fdir_flush_hits(struct ixgbe_ring *rx_ring);
 
 void ixgbe_irq_rearm_queues(struct ixgbe_adapter *adapter, u64 qmask);
 #endif /* _IXGBE_TXRX_COMMON_H_ */
@@ -1258,6 +1258,11 @@ struct ixgbe_dmac_config {
 #define IXGBE_TSIM	0x08C68 /* TimeSync Interrupt Mask Register - RW */
 #define IXGBE_TSICR	0x08C60 /* TimeSync Interrupt Cause Register - WO */
 #define IXGBE_TSSDP	0x0003C /* TimeSync SDP Configuration Register - RW */
+#define IXGBE_TRGTTIML(_i)	(IXGBE_TRGTTIML0 + ((_i) * 8)) /* X550 _i=0..1 */
+#define IXGBE_TRGTTIMH(_i)	(IXGBE_TRGTTIMH0 + ((_i) * 8)) /* X550 _i=0..1 */
+#define IXGBE_FREQOUT(_i)	(IXGBE_FREQOUT0 + ((_i) * 4)) /* X550 _i=0..1 */
+#define IXGBE_AUXSTMPL(_i)	(IXGBE_AUXSTMPL0 + ((_i) * 8)) /* _i=0..1 */
+#define IXGBE_AUXSTMPH(_i)	(IXGBE_AUXSTMPH0 + ((_i) * 8)) /* _i=0..1 */
 
 /* Diagnostic Registers */
 #define IXGBE_RDSTATCTL		0x02C20
@@ -2121,6 +2126,10 @@ enum {
 #define IXGBE_ESDP_SDP7_DIR	0x00008000 /* SDP7 IO direction */
 #define IXGBE_ESDP_SDP0_NATIVE	0x00010000 /* SDP0 IO mode */
 #define IXGBE_ESDP_SDP1_NATIVE	0x00020000 /* SDP1 IO mode */
+#define IXGBE_ESDP_SDP2_NATIVE	0x00040000 /* SDP2 IO mode */
+#define IXGBE_ESDP_SDP3_NATIVE	0x00080000 /* SDP3 IO mode */
+#define IXGBE_ESDP_SDP_DIR(_i)		(IXGBE_ESDP_SDP0_DIR << (_i))
+#define IXGBE_ESDP_SDP_NATIVE(_i)	(IXGBE_ESDP_SDP0_NATIVE << (_i))
 
 
 /* LEDCTL Bit Masks */
@@ -2581,10 +2590,29 @@ enum {
 #define IXGBE_TSAUXC_EN_TT1		0x00000002
 #define IXGBE_TSAUXC_ST0		0x00000010
 #define IXGBE_TSAUXC_DISABLE_SYSTIME	0x80000000
+/* X550 and later */
+#define IXGBE_TSAUXC_EN_CLK1		0x00000020
+#define IXGBE_TSAUXC_ST1		0x00000080
+#define IXGBE_TSAUXC_EN_TS0		0x00000100
+#define IXGBE_TSAUXC_EN_TS1		0x00000400
+#define IXGBE_TSAUXC_DIS_TS_CLEAR	0x40000000
+#define IXGBE_TSAUXC_EN_TT(_i)		(IXGBE_TSAUXC_EN_TT0 << (_i))
+#define IXGBE_TSAUXC_EN_CLKOUT(_i)	((_i) ? IXGBE_TSAUXC_EN_CLK1 : \
+					 IXGBE_TSAUXC_EN_CLK)
+#define IXGBE_TSAUXC_ST(_i)		((_i) ? IXGBE_TSAUXC_ST1 : \
+					 IXGBE_TSAUXC_ST0)
+#define IXGBE_TSAUXC_EN_TS(_i)		((_i) ? IXGBE_TSAUXC_EN_TS1 : \
+					 IXGBE_TSAUXC_EN_TS0)
 
 #define IXGBE_TSSDP_TS_SDP0_SEL_MASK	0x000000C0
 #define IXGBE_TSSDP_TS_SDP0_CLK0	0x00000080
 #define IXGBE_TSSDP_TS_SDP0_EN		0x00000100
+/* X550 and later: per SDP output select, and SDP select for AUXSTMP0/1 */
+#define IXGBE_TSSDP_TS_SDP_SEL_SHIFT(_i)	(6 + ((_i) * 3))
+#define IXGBE_TSSDP_TS_SDP_SEL_CLK(_i)	(2 + (_i)) /* FREQOUT0/1 */
+#define IXGBE_TSSDP_TS_SDP_EN(_i)	(IXGBE_TSSDP_TS_SDP0_EN << ((_i) * 3))
+#define IXGBE_TSSDP_AUX_SEL_SHIFT(_i)	((_i) * 3)
+#define IXGBE_TSSDP_AUX_SDP_EN(_i)	(0x00000004 << ((_i) * 3))
 
 #define IXGBE_TSYNCTXCTL_VALID		0x00000001 /* Tx timestamp valid */
 #define IXGBE_TSYNCTXCTL_ENABLED	0x00000010 /* Tx timestamping enabled */
@@ -2602,11 +2630,17 @@ enum {
 
 #define IXGBE_TSIM_SYS_WRAP		0x00000001
 #define IXGBE_TSIM_TXTS			0x00000002
+#define IXGBE_TSIM_AUTT0		0x00000020
+#define IXGBE_TSIM_AUTT1		0x00000040
 #define IXGBE_TSIM_TADJ			0x00000080
+#define IXGBE_TSIM_AUTT(_i)		(IXGBE_TSIM_AUTT0 << (_i))
 
 #define IXGBE_TSICR_SYS_WRAP		IXGBE_TSIM_SYS_WRAP
 #define IXGBE_TSICR_TXTS		IXGBE_TSIM_TXTS
+#define IXGBE_TSICR_AUTT0		IXGBE_TSIM_AUTT0
+#define IXGBE_TSICR_AUTT1		IXGBE_TSIM_AUTT1
 #define IXGBE_TSICR_TADJ		IXGBE_TSIM_TADJ
+#define IXGBE_TSICR_AUTT(_i)		IXGBE_TSIM_AUTT(_i)
 
 #define IXGBE_RXMTRL_V1_CTRLT_MASK	0x000000FF
 #define IXGBE_RXMTRL_V1_SYNC_MSG	0x00
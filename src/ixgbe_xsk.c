@@ -796,12 +796,15 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 		ixgbe_xdp_ring_update_tail_locked(ring);
 	}
 
+	ixgbe_fdir_flush_hits(rx_ring);
+
 	u64_stats_update_begin(&rx_ring->syncp);
 	rx_ring->stats.packets += total_rx_packets;
 	rx_ring->stats.bytes += total_rx_bytes;
 	u64_stats_update_end(&rx_ring->syncp);
 	q_vector->rx.total_packets += total_rx_packets;
 	q_vector->rx.total_bytes += total_rx_bytes;
+	ixgbe_hist_add(q_vector, IXGBE_HIST_RX_PKTS, total_rx_packets);
 
 	return failure ? budget : (int)total_rx_packets;
 }
@@ -155,6 +155,9 @@ function gen-ethtool() {
 	gen HAVE_ETHTOOL_GET_FEC_STATS_OPS if struct ethtool_ops matches '\\*get_fec_stats' in "$eth"
 	gen HAVE_ETHTOOL_KEEE if struct ethtool_keee in "$eth"
 	gen HAVE_ETHTOOL_KERNEL_TS_INFO if struct kernel_ethtool_ts_info in "$eth"
+	gen HAVE_ETHTOOL_RXFH_CONTEXT_OPS if method create_rxfh_context of ethtool_ops in "$eth"
+	gen HAVE_ETHTOOL_RXFH_MAX_NUM_CONTEXTS if struct ethtool_ops matches 'rxfh_max_num_contexts' in "$eth"
+	gen HAVE_ETHTOOL_RXFH_PER_CTX_KEY if struct ethtool_ops matches 'rxfh_per_ctx_key' in "$eth"
 	gen HAVE_ETHTOOL_RXFH_PARAM if struct ethtool_rxfh_param in "$eth"
 	gen NEED_ETHTOOL_SPRINTF if fun ethtool_sprintf absent in "$eth"
 	gen HAVE_ETHTOOL_FLOW_RSS if macro FLOW_RSS in "$ueth"
@@ -275,6 +278,7 @@ function gen-ptp() {
 	gen HAVE_PTP_CLOCK_INFO_ADJFINE if method adjfine of ptp_clock_info in "$clockh"
 	gen HAVE_PTP_CLOCK_INFO_GETTIME64 if method gettime64 of ptp_clock_info in "$clockh"
 	gen HAVE_PTP_CLOCK_INFO_GETTIMEX64 if method gettimex64 of ptp_clock_info in "$clockh"
+	gen HAVE_PTP_CLOCK_INFO_SUPPORTED_FLAGS if struct ptp_clock_info matches supported_extts_flags in "$clockh"
 	gen HAVE_PTP_FIND_PIN_UNLOCKED if fun ptp_find_pin_unlocked in "$clockh"
 	gen NEED_DIFF_BY_SCALED_PPM if fun diff_by_scaled_ppm absent in "$clockh"
 	gen NEED_PTP_SYSTEM_TIMESTAMP if fun ptp_read_system_prets absent in "$clockh"
@@ -338,6 +342,7 @@ function gen-other() {
 	gen NEED_FIND_NEXT_BIT_WRAP if fun find_next_bit_wrap absent in include/linux/find.h
 	gen HAVE_FILE_IN_SEQ_FILE if struct seq_file matches 'struct file' in include/linux/fs.h
 	gen NEED_FS_FILE_DENTRY if fun file_dentry absent in include/linux/fs.h
+	gen NEED_HRTIMER_SETUP if fun hrtimer_setup absent in include/linux/hrtimer.h
 	gen HAVE_HWMON_DEVICE_REGISTER_WITH_INFO if fun hwmon_device_register_with_info in include/linux/hwmon.h
 	gen NEED_HWMON_CHANNEL_INFO if macro HWMON_CHANNEL_INFO absent in include/linux/hwmon.h
 	gen NEED_ETH_TYPE_VLAN if fun eth_type_vlan absent in include/linux/if_vlan.h
@@ -4038,6 +4038,13 @@ static inline int _kc_kstrtol_from_user(const char __user *s, size_t count,
 #define dcb_ieee_delapp(dev, app) 0
 #define dcb_ieee_getapp_mask(dev, app) (1 << app->priority)
 
+#include <net/ip.h>
+static inline bool __kc_ip_is_fragment(const struct iphdr *iph)
+{
+	return (iph->frag_off & htons(IP_MF | IP_OFFSET)) != 0;
+}
+#define ip_is_fragment(iph) __kc_ip_is_fragment(iph)
+
 /* 1000BASE-T Control register */
 #define CTL1000_AS_MASTER	0x0800
 #define CTL1000_ENABLE_MASTER	0x1000
@@ -5233,6 +5240,9 @@ static inline void __kc_ether_addr_copy(u8 *dst, const u8 *src)
 int __kc_ipv6_find_hdr(const struct sk_buff *skb, unsigned int *offset,
 		       int target, unsigned short *fragoff, int *flags);
 #define ipv6_find_hdr(a, b, c, d, e) __kc_ipv6_find_hdr((a), (b), (c), (d), (e))
+#if ( LINUX_VERSION_CODE < KERNEL_VERSION(3,8,0) )
+#define IP6_FH_F_FRAG	BIT(0)
+#endif /* < 3.8.0 */
 
 #ifndef OPTIMIZE_HIDE_VAR
 #ifdef __GNUC__
@@ -2607,6 +2607,24 @@ static inline size_t list_count_nodes(struct list_head *head)
 	return count;
 }
 #endif /* NEED_LIST_COUNT_NODES */
+
+#ifdef NEED_HRTIMER_SETUP
+#include <linux/hrtimer.h>
+/* hrtimer_setup() was added by upstream commit ("hrtimers: Introduce
+ * hrtimer_setup() to replace hrtimer_init()") in Linux v6.13, and
+ * hrtimer_init() was removed later on.
+ *
+ * For older kernels, initialize the timer and set the callback by hand.
+ */
+static inline void
+hrtimer_setup(struct hrtimer *timer,
+	      enum hrtimer_restart (*function)(struct hrtimer *),
+	      clockid_t clock_id, enum hrtimer_mode mode)
+{
+	hrtimer_init(timer, clock_id, mode);
+	timer->function = function;
+}
+#endif /* NEED_HRTIMER_SETUP */
 #ifdef NEED_STATIC_ASSERT
 /*
  * NEED_STATIC_ASSERT Introduced with upstream commit 6bab69c6501